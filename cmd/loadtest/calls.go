@@ -0,0 +1,78 @@
+package main
+
+import (
+	"runtime"
+	"time"
+
+	"gpu-device-plugin/pkg/erml"
+)
+
+// call is one getter of the erml device API
+type call struct {
+	name string
+	fn   func(d erml.Device) error
+}
+
+// calls covers the getters the plugin and the exporters poll, GetBdf and
+// GetSsmFwHeartBeat are read from sysfs
+var calls = []call{
+	{"GetBdf", func(d erml.Device) error { _, err := d.GetBdf(); return err }},
+	{"GetDevInfo", func(d erml.Device) error { _, err := d.GetDevInfo(); return err }},
+	{"GetDevIsHealth", func(d erml.Device) error { _, err := d.GetDevIsHealth(); return err }},
+	{"GetDevMem", func(d erml.Device) error { _, err := d.GetDevMem(); return err }},
+	{"GetClusterCount", func(d erml.Device) error { _, err := d.GetClusterCount(); return err }},
+	{"GetDevClusterHbmMem", func(d erml.Device) error { _, err := d.GetDevClusterHbmMem(0); return err }},
+	{"GetDevEccStatus", func(d erml.Device) error { _, err := d.GetDevEccStatus(); return err }},
+	{"GetDevRmaDetails", func(d erml.Device) error { _, err := d.GetDevRmaDetails(); return err }},
+	{"GetDevTempV2", func(d erml.Device) error { _, err := d.GetDevTempV2(); return err }},
+	{"GetPcieLinkInfo", func(d erml.Device) error { _, err := d.GetPcieLinkInfo(); return err }},
+	{"GetPcieThroughput", func(d erml.Device) error { _, err := d.GetPcieThroughput(); return err }},
+	{"GetSsmFwHeartBeat", func(d erml.Device) error { _, err := d.GetSsmFwHeartBeat(); return err }},
+	{"GetEslPortNum", func(d erml.Device) error { _, err := d.GetEslPortNum(); return err }},
+	{"GetEslPortInfo", func(d erml.Device) error { _, err := d.GetEslPortInfo(0); return err }},
+	{"GetNumaNode", func(d erml.Device) error { _, err := d.GetNumaNode(); return err }},
+	{"GetDevDtuUsageAsync", func(d erml.Device) error { _, err := d.GetDevDtuUsageAsync(); return err }},
+	{"GetDevPGCount", func(d erml.Device) error { _, err := d.GetDevPGCount(); return err }},
+	{"GetPGUsageAsync", func(d erml.Device) error { _, err := d.GetPGUsageAsync(0); return err }},
+	{"AppendVdevList", appendVdevs()},
+	{"AppendProcessInfo", appendProcesses()},
+	{"Snapshot", func(d erml.Device) error { _, err := d.Snapshot(erml.SnapAll); return err }},
+}
+
+// the list getters reuse their result, as the periodic samplers do
+func appendVdevs() func(d erml.Device) error {
+	var dst []uint
+	return func(d erml.Device) (err error) {
+		dst, err = d.AppendVdevList(dst[:0])
+		return
+	}
+}
+
+func appendProcesses() func(d erml.Device) error {
+	var dst []erml.ProcessInfo
+	return func(d erml.Device) (err error) {
+		dst, err = d.AppendProcessInfo(dst[:0])
+		return
+	}
+}
+
+// timeCalls runs every getter n times in a row on device dev_idx and adds
+// them to rp, the allocations are counted over the n calls of a getter
+func timeCalls(rp *report, dev_idx uint, n int) {
+	d := erml.DeviceByIndex(dev_idx)
+	var before, after runtime.MemStats
+	for _, c := range calls {
+		r := newRecorder("erml." + c.name)
+		r.samples = make([]time.Duration, 0, n)
+		runtime.ReadMemStats(&before)
+		begin := time.Now()
+		for i := 0; i < n; i++ {
+			start := time.Now()
+			r.observe(start, c.fn(d))
+		}
+		elapsed := time.Since(begin)
+		runtime.ReadMemStats(&after)
+		r.setAllocs(float64(after.Mallocs-before.Mallocs) / float64(n))
+		rp.add(r, elapsed)
+	}
+}
@@ -0,0 +1,80 @@
+package main
+
+import (
+	"context"
+	"fmt"
+	"net"
+	"os"
+	"time"
+
+	"github.com/pkg/errors"
+	"google.golang.org/grpc"
+	"google.golang.org/grpc/credentials/insecure"
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+)
+
+// fakeKubelet serves the registration socket of kubelet and hands the
+// registrations over to the load test
+type fakeKubelet struct {
+	server     *grpc.Server
+	registered chan *pluginapi.RegisterRequest
+}
+
+func startKubelet(socket string) (*fakeKubelet, error) {
+	if err := os.Remove(socket); err != nil && !os.IsNotExist(err) {
+		return nil, errors.WithMessagef(err, "delete socket %s failed", socket)
+	}
+	sock, err := net.Listen("unix", socket)
+	if err != nil {
+		return nil, errors.WithMessagef(err, "listen unix %s failed", socket)
+	}
+	k := &fakeKubelet{
+		server:     grpc.NewServer(),
+		registered: make(chan *pluginapi.RegisterRequest, 1),
+	}
+	pluginapi.RegisterRegistrationServer(k.server, k)
+	go k.server.Serve(sock)
+	return k, nil
+}
+
+func (k *fakeKubelet) Register(_ context.Context, req *pluginapi.RegisterRequest) (*pluginapi.Empty, error) {
+	if req.Version != pluginapi.Version {
+		return nil, fmt.Errorf("unsupported device plugin api version %s", req.Version)
+	}
+	select {
+	case k.registered <- req:
+	default:
+	}
+	return &pluginapi.Empty{}, nil
+}
+
+// wait returns the first registration
+func (k *fakeKubelet) wait(timeout time.Duration) (*pluginapi.RegisterRequest, error) {
+	select {
+	case req := <-k.registered:
+		return req, nil
+	case <-time.After(timeout):
+		return nil, errors.New("no device plugin registered")
+	}
+}
+
+func (k *fakeKubelet) Stop() {
+	k.server.Stop()
+}
+
+// dial connects to a plugin socket the way kubelet does
+func dial(socket string, timeout time.Duration) (*grpc.ClientConn, error) {
+	ctx, cancel := context.WithTimeout(context.Background(), timeout)
+	defer cancel()
+	conn, err := grpc.DialContext(ctx, socket,
+		grpc.WithTransportCredentials(insecure.NewCredentials()),
+		grpc.WithBlock(),
+		grpc.WithContextDialer(func(ctx context.Context, addr string) (net.Conn, error) {
+			return (&net.Dialer{}).DialContext(ctx, "unix", addr)
+		}),
+	)
+	if err != nil {
+		return nil, errors.WithMessagef(err, "connect to %s failed", socket)
+	}
+	return conn, nil
+}
@@ -0,0 +1,103 @@
+package main
+
+import (
+	"fmt"
+	"io"
+	"math"
+	"sort"
+	"sync"
+	"time"
+)
+
+// recorder keeps every latency of an operation, a run is short enough for
+// exact percentiles
+type recorder struct {
+	name string
+
+	mu      sync.Mutex
+	samples []time.Duration
+	errors  int
+	allocs  float64 // heap allocations per operation, negative if unknown
+}
+
+func newRecorder(name string) *recorder {
+	return &recorder{name: name, allocs: -1}
+}
+
+// observe records a call that started at start, failed calls only count as
+// errors
+func (r *recorder) observe(start time.Time, err error) {
+	d := time.Since(start)
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	if err != nil {
+		r.errors++
+		return
+	}
+	r.samples = append(r.samples, d)
+}
+
+func (r *recorder) setAllocs(allocs float64) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	r.allocs = allocs
+}
+
+// stat summarizes a recorder, it is also the JSON report entry
+type stat struct {
+	Count  int           `json:"count"`
+	Errors int           `json:"errors"`
+	P50    time.Duration `json:"p50"`
+	P99    time.Duration `json:"p99"`
+	P999   time.Duration `json:"p999"`
+	Max    time.Duration `json:"max"`
+	Rate   float64       `json:"ops_per_second"`
+	Allocs float64       `json:"allocs_per_op"`
+}
+
+// percentile of sorted samples, nearest rank
+func percentile(sorted []time.Duration, p float64) time.Duration {
+	if len(sorted) == 0 {
+		return 0
+	}
+	rank := int(math.Ceil(p*float64(len(sorted)))) - 1
+	if rank < 0 {
+		rank = 0
+	}
+	return sorted[rank]
+}
+
+// stat computes the summary, the throughput is over elapsed as the workers
+// share it with the other operations
+func (r *recorder) stat(elapsed time.Duration) stat {
+	r.mu.Lock()
+	sorted := append([]time.Duration(nil), r.samples...)
+	s := stat{Count: len(sorted), Errors: r.errors, Allocs: r.allocs}
+	r.mu.Unlock()
+
+	sort.Slice(sorted, func(i, j int) bool { return sorted[i] < sorted[j] })
+	if len(sorted) > 0 {
+		s.Max = sorted[len(sorted)-1]
+	}
+	if elapsed > 0 {
+		s.Rate = float64(len(sorted)) / elapsed.Seconds()
+	}
+	s.P50 = percentile(sorted, 0.50)
+	s.P99 = percentile(sorted, 0.99)
+	s.P999 = percentile(sorted, 0.999)
+	return s
+}
+
+func writeHeader(w io.Writer) {
+	fmt.Fprintf(w, "%-28s %8s %7s %12s %12s %12s %12s %10s %10s\n",
+		"op", "count", "errors", "p50", "p99", "p999", "max", "ops/s", "allocs/op")
+}
+
+func writeStat(w io.Writer, name string, s stat) {
+	allocs := "-"
+	if s.Allocs >= 0 {
+		allocs = fmt.Sprintf("%.1f", s.Allocs)
+	}
+	fmt.Fprintf(w, "%-28s %8d %7d %12v %12v %12v %12v %10.1f %10s\n", name, s.Count, s.Errors,
+		s.P50, s.P99, s.P999, s.Max, s.Rate, allocs)
+}
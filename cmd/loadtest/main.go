@@ -0,0 +1,339 @@
+// loadtest runs the device plugin against a fake kubelet on unix sockets
+// and reports the latencies of the device plugin API under concurrent pod
+// admissions. Use -sim, or the liberml stub of hack/erml-stub, to run it
+// without a card.
+package main
+
+import (
+	"context"
+	"flag"
+	"fmt"
+	"os"
+	"path"
+	"runtime"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"gpu-device-plugin/pkg/common"
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/erml/sim"
+	"gpu-device-plugin/pkg/plugin"
+
+	"k8s.io/klog/v2"
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+)
+
+func main() {
+	opts := plugin.DefaultOptions()
+	// the heartbeat is read from sysfs, which neither the simulator nor the
+	// stub provide
+	opts.HeartbeatInterval = 0
+	opts.MetricsAddr = ""
+	flag.IntVar(&opts.Replicas, "replicas", opts.Replicas,
+		fmt.Sprintf("advertise every card as this many time-sliced replicas, at most %d", common.MaxReplicas))
+	flag.IntVar(&opts.MemSlice, "mem-slice", opts.MemSlice,
+		"advertise every card as slices of this many GiB of HBM, 0 to disable")
+	flag.DurationVar(&opts.HealthInterval, "health-interval", opts.HealthInterval,
+		"period of the ECC, RMA, thermal and PCIe health rules, 0 to disable")
+	dir := flag.String("dir", "", "directory of the sockets, a temporary one when empty")
+	scenario := flag.String("sim", "",
+		"run against a simulated node described by this scenario file instead of liberml")
+	pods := flag.Int("pods", 1000, "number of simulated pod admissions")
+	concurrency := flag.Int("concurrency", 16, "admissions in flight at once")
+	sizesFlag := flag.String("sizes", "1", "comma separated devices per pod, used in turn")
+	watchers := flag.Int("watchers", 1, "concurrent ListAndWatch streams")
+	timeout := flag.Duration("timeout", 10*time.Second, "timeout of a single call")
+	ermlCalls := flag.Int("erml-calls", 0, "also time this many calls of every erml getter on device 0")
+	out := flag.String("out", "", "save the report as JSON to this file")
+	baseline := flag.String("baseline", "", "compare with the JSON report of an earlier run")
+	threshold := flag.Float64("threshold", 0.1, "growth over the baseline reported as a regression")
+	klog.InitFlags(nil)
+	flag.Parse()
+
+	sizes, err := parseSizes(*sizesFlag)
+	if err != nil {
+		klog.Fatalf("invalid -sizes: %v", err)
+	}
+	if *concurrency < 1 || *watchers < 1 {
+		klog.Fatalf("-concurrency and -watchers must be at least 1")
+	}
+	if *scenario != "" {
+		sc, err := sim.Load(*scenario)
+		if err != nil {
+			klog.Fatalf("load simulation scenario failed: %v", err)
+		}
+		erml.SetBackend(sim.New(sc))
+	}
+	if *dir == "" {
+		if *dir, err = os.MkdirTemp("", "loadtest"); err != nil {
+			klog.Fatalf("create socket directory failed: %v", err)
+		}
+		defer os.RemoveAll(*dir)
+	}
+	opts.PluginDir = *dir
+
+	kubelet, err := startKubelet(opts.KubeletSocket())
+	if err != nil {
+		klog.Fatalf("start fake kubelet failed: %v", err)
+	}
+	defer kubelet.Stop()
+
+	dp, err := plugin.NewGpuDevicePlugin(opts)
+	if err != nil {
+		klog.Fatalf("create device plugin failed: %v", err)
+	}
+	defer dp.Stop()
+	if err := dp.Run(); err != nil {
+		klog.Fatalf("run device plugin failed: %v", err)
+	}
+	if err := dp.Register(); err != nil {
+		klog.Fatalf("register to kubelet failed: %v", err)
+	}
+	reg, err := kubelet.wait(*timeout)
+	if err != nil {
+		klog.Fatalf("%v", err)
+	}
+	conn, err := dial(path.Join(*dir, reg.Endpoint), *timeout)
+	if err != nil {
+		klog.Fatalf("%v", err)
+	}
+	defer conn.Close()
+
+	lt := newLoadTest(pluginapi.NewDevicePluginClient(conn), *timeout)
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	if err := lt.watch(ctx, *watchers); err != nil {
+		klog.Fatalf("%v", err)
+	}
+
+	// the allocations are the whole process, the plugin and the client
+	var before, after runtime.MemStats
+	runtime.ReadMemStats(&before)
+	start := time.Now()
+	lt.run(*pods, *concurrency, sizes)
+	elapsed := time.Since(start)
+	runtime.ReadMemStats(&after)
+	if admitted := lt.pod.stat(elapsed).Count; admitted > 0 {
+		lt.pod.setAllocs(float64(after.Mallocs-before.Mallocs) / float64(admitted))
+	}
+
+	fmt.Printf("%s: %d pods, %d in flight, sizes %s, %d devices, %d watchers, %v\n",
+		reg.ResourceName, *pods, *concurrency, *sizesFlag, len(lt.healthy()), *watchers, elapsed.Round(time.Millisecond))
+	if skipped := lt.skipped.Load(); skipped > 0 {
+		fmt.Printf("%d pods skipped, not enough healthy devices\n", skipped)
+	}
+	rp := newReport()
+	for _, r := range []*recorder{lt.listAndWatch, lt.preferred, lt.allocate, lt.preStart, lt.pod} {
+		rp.add(r, elapsed)
+	}
+	if *ermlCalls > 0 {
+		timeCalls(rp, 0, *ermlCalls)
+	}
+	rp.write(os.Stdout)
+	fmt.Printf("%d device list updates\n", lt.updates.Load())
+
+	if *out != "" {
+		if err := rp.save(*out); err != nil {
+			klog.Fatalf("%v", err)
+		}
+	}
+	if *baseline != "" {
+		base, err := loadReport(*baseline)
+		if err != nil {
+			klog.Fatalf("%v", err)
+		}
+		if regressions := rp.regressions(base, *threshold); len(regressions) > 0 {
+			for _, r := range regressions {
+				fmt.Printf("regression: %s\n", r)
+			}
+			cancel()
+			dp.Stop()
+			os.Exit(1)
+		}
+		fmt.Printf("no regression over %s\n", *baseline)
+	}
+}
+
+func parseSizes(s string) ([]int, error) {
+	var sizes []int
+	for _, f := range strings.Split(s, ",") {
+		size, err := strconv.Atoi(strings.TrimSpace(f))
+		if err != nil {
+			return nil, err
+		}
+		if size < 1 {
+			return nil, fmt.Errorf("size %d below 1", size)
+		}
+		sizes = append(sizes, size)
+	}
+	return sizes, nil
+}
+
+// loadTest plays kubelet admitting pods: the preferred allocation over the
+// devices last listed, the allocation and the pre-start of every pod
+type loadTest struct {
+	client  pluginapi.DevicePluginClient
+	timeout time.Duration
+	devices atomic.Pointer[[]string] // healthy IDs of the last device list
+
+	listAndWatch *recorder // until the first device list of a stream
+	preferred    *recorder
+	allocate     *recorder
+	preStart     *recorder
+	pod          *recorder // the three calls of a pod
+	updates      atomic.Int64
+	skipped      atomic.Int64
+}
+
+func newLoadTest(client pluginapi.DevicePluginClient, timeout time.Duration) *loadTest {
+	return &loadTest{
+		client:       client,
+		timeout:      timeout,
+		listAndWatch: newRecorder("ListAndWatch"),
+		preferred:    newRecorder("GetPreferredAllocation"),
+		allocate:     newRecorder("Allocate"),
+		preStart:     newRecorder("PreStartContainer"),
+		pod:          newRecorder("pod"),
+	}
+}
+
+func (lt *loadTest) healthy() []string {
+	if ids := lt.devices.Load(); ids != nil {
+		return *ids
+	}
+	return nil
+}
+
+// watch opens the ListAndWatch streams, every one keeps the device list up
+// to date until ctx is done. It returns once they all got their first list.
+func (lt *loadTest) watch(ctx context.Context, watchers int) error {
+	errs := make(chan error, watchers)
+	for i := 0; i < watchers; i++ {
+		go func() {
+			start := time.Now()
+			stream, err := lt.client.ListAndWatch(ctx, &pluginapi.Empty{})
+			first := true
+			for err == nil {
+				var resp *pluginapi.ListAndWatchResponse
+				if resp, err = stream.Recv(); err != nil {
+					break
+				}
+				ids := make([]string, 0, len(resp.Devices))
+				for _, device := range resp.Devices {
+					if device.Health == pluginapi.Healthy {
+						ids = append(ids, device.ID)
+					}
+				}
+				lt.devices.Store(&ids)
+				if first {
+					lt.listAndWatch.observe(start, nil)
+					errs <- nil
+					first = false
+				} else {
+					lt.updates.Add(1)
+				}
+			}
+			if first {
+				lt.listAndWatch.observe(start, err)
+				errs <- err
+			} else if ctx.Err() == nil {
+				klog.Errorf("ListAndWatch stream closed: %v", err)
+			}
+		}()
+	}
+	for i := 0; i < watchers; i++ {
+		if err := <-errs; err != nil {
+			return fmt.Errorf("ListAndWatch failed: %v", err)
+		}
+	}
+	return nil
+}
+
+// run admits pods pods, concurrency at a time, the n-th asking for
+// sizes[n%len(sizes)] devices
+func (lt *loadTest) run(pods, concurrency int, sizes []int) {
+	var next atomic.Int64
+	var wg sync.WaitGroup
+	for w := 0; w < concurrency; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for {
+				n := int(next.Add(1)) - 1
+				if n >= pods {
+					return
+				}
+				lt.admit(sizes[n%len(sizes)])
+			}
+		}()
+	}
+	wg.Wait()
+}
+
+func (lt *loadTest) admit(size int) {
+	available := lt.healthy()
+	if len(available) < size {
+		lt.skipped.Add(1)
+		return
+	}
+	ctx, cancel := context.WithTimeout(context.Background(), lt.timeout)
+	defer cancel()
+
+	podStart := time.Now()
+	start := podStart
+	pref, err := lt.client.GetPreferredAllocation(ctx, &pluginapi.PreferredAllocationRequest{
+		ContainerRequests: []*pluginapi.ContainerPreferredAllocationRequest{{
+			AvailableDeviceIDs: available,
+			AllocationSize:     int32(size),
+		}},
+	})
+	lt.preferred.observe(start, err)
+	if err != nil {
+		lt.pod.observe(podStart, err)
+		return
+	}
+	ids := choose(pref, available, size)
+
+	start = time.Now()
+	_, err = lt.client.Allocate(ctx, &pluginapi.AllocateRequest{
+		ContainerRequests: []*pluginapi.ContainerAllocateRequest{{DevicesIDs: ids}},
+	})
+	lt.allocate.observe(start, err)
+	if err != nil {
+		lt.pod.observe(podStart, err)
+		return
+	}
+
+	start = time.Now()
+	_, err = lt.client.PreStartContainer(ctx, &pluginapi.PreStartContainerRequest{DevicesIDs: ids})
+	lt.preStart.observe(start, err)
+	lt.pod.observe(podStart, err)
+}
+
+// choose takes the preferred devices and completes them from the available
+// ones, as the devicemanager does with a short preference
+func choose(pref *pluginapi.PreferredAllocationResponse, available []string, size int) []string {
+	ids := make([]string, 0, size)
+	seen := make(map[string]bool, size)
+	if len(pref.ContainerResponses) > 0 {
+		for _, id := range pref.ContainerResponses[0].DeviceIDs {
+			if len(ids) < size && !seen[id] {
+				ids = append(ids, id)
+				seen[id] = true
+			}
+		}
+	}
+	for _, id := range available {
+		if len(ids) == size {
+			break
+		}
+		if !seen[id] {
+			ids = append(ids, id)
+			seen[id] = true
+		}
+	}
+	return ids
+}
@@ -0,0 +1,80 @@
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"io"
+	"os"
+	"time"
+
+	"github.com/pkg/errors"
+)
+
+// report is the result of a run, saved as JSON it is the baseline of the
+// next ones
+type report struct {
+	Ops   map[string]stat `json:"ops"`
+	order []string
+}
+
+func newReport() *report {
+	return &report{Ops: make(map[string]stat)}
+}
+
+func (rp *report) add(r *recorder, elapsed time.Duration) {
+	rp.Ops[r.name] = r.stat(elapsed)
+	rp.order = append(rp.order, r.name)
+}
+
+func (rp *report) write(w io.Writer) {
+	writeHeader(w)
+	for _, name := range rp.order {
+		writeStat(w, name, rp.Ops[name])
+	}
+}
+
+func (rp *report) save(path string) error {
+	data, err := json.MarshalIndent(rp, "", "  ")
+	if err != nil {
+		return err
+	}
+	if err := os.WriteFile(path, append(data, '\n'), 0644); err != nil {
+		return errors.WithMessage(err, "write report failed")
+	}
+	return nil
+}
+
+func loadReport(path string) (*report, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return nil, errors.WithMessage(err, "read baseline failed")
+	}
+	rp := newReport()
+	if err := json.Unmarshal(data, rp); err != nil {
+		return nil, errors.WithMessagef(err, "parse baseline %s failed", path)
+	}
+	return rp, nil
+}
+
+// regressions lists the operations whose median or p99 grew by more than
+// threshold over the baseline. The p999 of a short run is too noisy to gate
+// on, and so are the allocations, counted over the whole process: the
+// benchmarks of make bench gate on allocs/op.
+func (rp *report) regressions(base *report, threshold float64) []string {
+	var ret []string
+	worse := func(name, what string, cur, old float64) {
+		if old > 0 && cur > old*(1+threshold) {
+			ret = append(ret, fmt.Sprintf("%s %s %.4g -> %.4g (%+.1f%%)", name, what, old, cur, (cur/old-1)*100))
+		}
+	}
+	for _, name := range rp.order {
+		cur := rp.Ops[name]
+		old, ok := base.Ops[name]
+		if !ok || cur.Count == 0 || old.Count == 0 {
+			continue
+		}
+		worse(name, "p50 ns", float64(cur.P50), float64(old.P50))
+		worse(name, "p99 ns", float64(cur.P99), float64(old.P99))
+	}
+	return ret
+}
@@ -1,16 +1,68 @@
 package main
 
 import (
+	"flag"
+	"fmt"
+
+	"gpu-device-plugin/pkg/common"
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/erml/sim"
 	"gpu-device-plugin/pkg/plugin"
 	"gpu-device-plugin/pkg/utils"
 
 	"k8s.io/klog/v2"
 )
 
-
 func main() {
+	opts := plugin.DefaultOptions()
+	flag.DurationVar(&opts.CoalesceWindow, "coalesce-window", opts.CoalesceWindow,
+		"merge device changes within this window into one kubelet update")
+	flag.StringVar(&opts.MetricsAddr, "metrics-addr", opts.MetricsAddr,
+		"listen address of the /metrics endpoint, empty to disable")
+	flag.DurationVar(&opts.MetricsInterval, "metrics-interval", opts.MetricsInterval,
+		"period of the device telemetry sampling")
+	flag.DurationVar(&opts.UsageInterval, "usage-interval", opts.UsageInterval,
+		"period of the async usage sampling, 0 to disable")
+	flag.DurationVar(&opts.UsageWindow, "usage-window", opts.UsageWindow,
+		"window of the exported usage statistics")
+	flag.DurationVar(&opts.HeartbeatInterval, "heartbeat-interval", opts.HeartbeatInterval,
+		"period of the firmware heartbeat watchdog, 0 to disable")
+	flag.IntVar(&opts.HeartbeatStalls, "heartbeat-stalls", opts.HeartbeatStalls,
+		"consecutive samples without a firmware heartbeat before a device is withdrawn")
+	flag.DurationVar(&opts.HealthInterval, "health-interval", opts.HealthInterval,
+		"period of the ECC, RMA, thermal and PCIe health rules, 0 to disable")
+	flag.IntVar(&opts.Replicas, "replicas", opts.Replicas,
+		fmt.Sprintf("advertise every card as this many time-sliced replicas, at most %d", common.MaxReplicas))
+	flag.IntVar(&opts.MemSlice, "mem-slice", opts.MemSlice,
+		"advertise every card as slices of this many GiB of HBM, 0 to disable")
+	flag.DurationVar(&opts.MemCheckInterval, "mem-check-interval", opts.MemCheckInterval,
+		"period of the check of the HBM used against the allocated slices")
+	flag.DurationVar(&opts.ProcessInterval, "process-interval", opts.ProcessInterval,
+		"period of the per-container accounting of the device processes, 0 to disable")
+	flag.BoolVar(&opts.Vgcu, "vgcu", opts.Vgcu,
+		"also advertise the virtual GCUs as "+common.VgcuResourceName)
+	flag.StringVar(&opts.PluginDir, "plugin-dir", opts.PluginDir,
+		"directory of the kubelet socket and the device plugin sockets")
+	scenario := flag.String("sim", "",
+		"run against a simulated node described by this scenario file instead of liberml")
+	klog.InitFlags(nil)
+	flag.Parse()
+
+	if *scenario != "" {
+		sc, err := sim.Load(*scenario)
+		if err != nil {
+			klog.Fatalf("load simulation scenario failed: %v", err)
+		}
+		klog.Infof("simulating the devices of %s", *scenario)
+		erml.SetBackend(sim.New(sc))
+	}
+
 	klog.Infof("device plugin starting")
-	dp := plugin.NewGpuDevicePlugin()
+	dp, err := plugin.NewGpuDevicePlugin(opts)
+	if err != nil {
+		klog.Fatalf("create device plugin failed: %v", err)
+	}
+	defer dp.Stop()
 	go dp.Run()
 
 	// register when device plugin start
@@ -18,9 +70,21 @@ func main() {
 		klog.Fatalf("register to kubelet failed: %v", err)
 	}
 
+	if opts.Vgcu {
+		vdp, err := plugin.NewVgcuDevicePlugin(opts, dp)
+		if err != nil {
+			klog.Fatalf("create vgcu device plugin failed: %v", err)
+		}
+		defer vdp.Stop()
+		go vdp.Run()
+		if err := vdp.Register(); err != nil {
+			klog.Fatalf("register vgcu to kubelet failed: %v", err)
+		}
+	}
+
 	// watch kubelet.sock,when kubelet restart,exit device plugin,then will restart by DaemonSet
 	stop := make(chan struct{})
-	err := utils.WatchKubelet(stop)
+	err = utils.WatchKubelet(opts.KubeletSocket(), stop)
 	if err != nil {
 		klog.Fatalf("start to kubelet failed: %v", err)
 	}
@@ -0,0 +1,92 @@
+#!/bin/sh
+# benchcmp compares two `go test -bench -benchmem` outputs the way benchstat
+# does: the median of the runs of every benchmark, old against new.
+#
+#   hack/benchcmp.sh [-t threshold] old.txt new.txt
+#
+# allocs/op do not depend on the machine, any growth is a regression. Times
+# do, so ns/op only gate with -t, e.g. -t 0.1 for 10%, against a baseline
+# recorded on the same machine. Exits with status 1 on a regression.
+set -eu
+
+threshold=-1
+if [ "${1:-}" = "-t" ]; then
+	threshold=$2
+	shift 2
+fi
+if [ $# -ne 2 ]; then
+	echo "usage: $0 [-t threshold] old.txt new.txt" >&2
+	exit 2
+fi
+
+awk -v threshold="$threshold" '
+function median(key,    n, i, j, v, a) {
+	n = count[key]
+	if (n == 0) {
+		return -1
+	}
+	for (i = 1; i <= n; i++) {
+		a[i] = sample[key, i]
+	}
+	for (i = 2; i <= n; i++) {
+		v = a[i]
+		for (j = i - 1; j > 0 && a[j] > v; j--) {
+			a[j + 1] = a[j]
+		}
+		a[j + 1] = v
+	}
+	return n % 2 ? a[(n + 1) / 2] : (a[n / 2] + a[n / 2 + 1]) / 2
+}
+function delta(old, cur) {
+	if (old <= 0) {
+		return cur > 0 ? "+inf" : "~"
+	}
+	if (old == cur) {
+		return "~"
+	}
+	return sprintf("%+.1f%%", (cur / old - 1) * 100)
+}
+FNR == 1 { side++ }
+/^Benchmark/ && NF >= 4 {
+	name = $1
+	sub(/-[0-9]+$/, "", name)
+	if (side == 2 && !(name in seen)) {
+		seen[name] = 1
+		order[++names] = name
+	}
+	for (i = 3; i < NF; i += 2) {
+		key = side SUBSEP name SUBSEP $(i + 1)
+		sample[key, ++count[key]] = $i
+	}
+}
+END {
+	printf "%-60s %12s %12s %8s %10s %10s %8s\n", "name", "old ns/op", "new ns/op", "delta", "old allocs", "new allocs", "delta"
+	failed = 0
+	for (k = 1; k <= names; k++) {
+		name = order[k]
+		oldNs = median(1 SUBSEP name SUBSEP "ns/op")
+		newNs = median(2 SUBSEP name SUBSEP "ns/op")
+		oldAllocs = median(1 SUBSEP name SUBSEP "allocs/op")
+		newAllocs = median(2 SUBSEP name SUBSEP "allocs/op")
+		if (oldNs < 0) {
+			printf "%-60s %12s %12.4g %8s\n", name, "-", newNs, "new"
+			continue
+		}
+		mark = ""
+		if (oldAllocs >= 0 && newAllocs > oldAllocs) {
+			mark = "  allocs regression"
+		} else if (threshold >= 0 && newNs > oldNs * (1 + threshold)) {
+			mark = "  time regression"
+		}
+		if (mark != "") {
+			failed++
+		}
+		printf "%-60s %12.4g %12.4g %8s %10s %10s %8s%s\n", name, oldNs, newNs, delta(oldNs, newNs),
+			oldAllocs < 0 ? "-" : oldAllocs, newAllocs < 0 ? "-" : newAllocs, delta(oldAllocs, newAllocs), mark
+	}
+	if (failed > 0) {
+		printf "%d regressions\n", failed
+		exit 1
+	}
+}
+' "$1" "$2"
@@ -0,0 +1,914 @@
+/////////////////////////////////////////////////////////////////////////////
+//  @brief Stub of the Enrigin Managerment Library
+//
+//  Implements every export of erml.h over the shared control file of
+//  erml_stub.h, so the dlopen path, the cgo bindings and the plugin can be
+//  exercised and benchmarked end to end without a card. Every call sleeps
+//  the configured latencies and fails with the configured codes.
+/////////////////////////////////////////////////////////////////////////////
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "erml_stub.h"
+
+#define DEFAULT_CTL_PATH "/dev/shm/erml-stub.ctl"
+#define DEFAULT_DEVICES  8
+
+static ermlStubCtl_t *ctl;
+
+static void delay(uint32_t ns) {
+    if (ns == 0) {
+        return;
+    }
+    struct timespec ts = {ns / 1000000000u, ns % 1000000000u};
+    nanosleep(&ts, NULL);
+}
+
+static ermlReturn_t enter(void) {
+    if (ctl == NULL) {
+        return ERML_ERROR_UNINITIALIZED;
+    }
+    delay(ctl->latency_ns);
+    if (ctl->fail_code != 0) {
+        return (ermlReturn_t)ctl->fail_code;
+    }
+    return ERML_SUCCESS;
+}
+
+static ermlReturn_t enter_dev(uint32_t dev_idx, ermlStubDev_t **dev) {
+    ermlReturn_t r = enter();
+    if (r != ERML_SUCCESS) {
+        return r;
+    }
+    if (dev_idx >= ctl->dev_count || dev_idx >= ERML_STUB_MAX_DEVS) {
+        return ERML_ERROR_INVALID_ARGUMENT;
+    }
+    ermlStubDev_t *d = &ctl->devs[dev_idx];
+    delay(d->latency_ns);
+    if (d->fail_code != 0) {
+        return (ermlReturn_t)d->fail_code;
+    }
+    *dev = d;
+    return ERML_SUCCESS;
+}
+
+#define ENTER()                                \
+    do {                                       \
+        ermlReturn_t r_ = enter();             \
+        if (r_ != ERML_SUCCESS) return r_;     \
+    } while (0)
+
+#define DEV(dev_idx)                                \
+    ermlStubDev_t *d = NULL;                        \
+    do {                                            \
+        ermlReturn_t r_ = enter_dev((dev_idx), &d); \
+        if (r_ != ERML_SUCCESS) return r_;          \
+    } while (0)
+
+#define OUT(p)                                              \
+    do {                                                    \
+        if ((p) == NULL) return ERML_ERROR_INVALID_ARGUMENT; \
+    } while (0)
+
+static void set_str(char *dst, const char *fmt, uint32_t arg) {
+    snprintf(dst, MAX_CHAR_BUFF_LEN, fmt, arg);
+}
+
+static void push_event(uint32_t dev_idx, ermlEventType_t type, const char *msg) {
+    uint32_t head = __atomic_fetch_add(&ctl->event_head, 1, __ATOMIC_ACQ_REL);
+    ermlEvent_t *e = &ctl->events[head % ERML_STUB_MAX_EVENTS];
+    e->event_id = dev_idx;
+    e->event_type = type;
+    snprintf(e->event_msg, MAX_CHAR_BUFF_LEN, "%s", msg);
+}
+
+static uint32_t env_count(const char *name, uint32_t def, uint32_t max) {
+    uint32_t n = def;
+    const char *v = getenv(name);
+    if (v != NULL && *v != '\0') {
+        n = (uint32_t)strtoul(v, NULL, 10);
+    }
+    return n < max ? n : max;
+}
+
+static void init_defaults(ermlStubCtl_t *c, uint32_t n, uint32_t vdevs) {
+    memset(c, 0, sizeof(*c));
+    c->magic = ERML_STUB_MAGIC;
+    c->version = ERML_STUB_VERSION;
+    c->dev_count = n;
+    for (uint32_t i = 0; i < n; i++) {
+        ermlStubDev_t *d = &c->devs[i];
+        d->healthy = true;
+        d->numa_node = i < n / 2 ? 0 : 1;
+        d->bus_id = i + 1;
+        d->hbm_total = 65536;
+        d->temp = (ermlDevThermalInfoV2_t){45, 40, 35};
+        d->pwr = (ermlDevPowerInfo_t){300, 100};
+        d->clk = (ermlDevClkInfo_t){1600, 1400};
+        d->link = (ermlPcieLinkInfo_t){ERML_LINK_SPEED_GEN4, ERML_LINK_SPEED_GEN4,
+                                       ERML_LINK_WIDTH_X16, ERML_LINK_WIDTH_X16};
+        d->ecc.enabled = true;
+        d->cluster_count = 4;
+        d->pg_count = 4;
+        d->esl_port_num = 2;
+        for (uint32_t p = 0; p < ERML_STUB_MAX_ESL_PORTS; p++) {
+            d->esl_remote[p] = -1;
+        }
+        if (n > 1) {
+            d->esl_remote[0] = (i + 1) % n;
+            d->esl_remote[1] = (i + n - 1) % n;
+        }
+        // vdevs take the gcu nodes after the cards, as with the simulator
+        d->vdev_count = vdevs;
+        for (uint32_t v = 0; v < vdevs; v++) {
+            d->vdevs[v] = n + i * vdevs + v;
+        }
+    }
+}
+
+ermlReturn_t ErmlInit(bool no_driver) {
+    (void)no_driver;
+    if (ctl != NULL) {
+        return ctl->fail_code != 0 ? (ermlReturn_t)ctl->fail_code : ERML_SUCCESS;
+    }
+
+    const char *path = getenv("ERML_STUB_CTL");
+    if (path == NULL || *path == '\0') {
+        path = DEFAULT_CTL_PATH;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return ERML_ERROR_DRIVER_NOT_LOADED;
+    }
+    flock(fd, LOCK_EX);
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        (st.st_size < (off_t)sizeof(ermlStubCtl_t) && ftruncate(fd, sizeof(ermlStubCtl_t)) != 0)) {
+        close(fd);
+        return ERML_ERROR_DRIVER_NOT_LOADED;
+    }
+    void *p = mmap(NULL, sizeof(ermlStubCtl_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        return ERML_ERROR_DRIVER_NOT_LOADED;
+    }
+    ermlStubCtl_t *c = p;
+    if (c->magic != ERML_STUB_MAGIC || c->version != ERML_STUB_VERSION) {
+        init_defaults(c, env_count("ERML_STUB_DEVICES", DEFAULT_DEVICES, ERML_STUB_MAX_DEVS),
+                      env_count("ERML_STUB_VDEVS", 0, ERML_STUB_MAX_VDEVS));
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    ctl = c;
+    return ctl->fail_code != 0 ? (ermlReturn_t)ctl->fail_code : ERML_SUCCESS;
+}
+
+void ErmlShutdown() {
+    if (ctl != NULL) {
+        munmap(ctl, sizeof(ermlStubCtl_t));
+        ctl = NULL;
+    }
+}
+
+ermlReturn_t ErmlErrorString(ermlReturn_t result, char *p_error_str) {
+    OUT(p_error_str);
+    const char *s;
+    switch (result) {
+    case ERML_SUCCESS: s = "Success"; break;
+    case ERML_ERROR_UNINITIALIZED: s = "Error, uninitialized"; break;
+    case ERML_ERROR_INVALID_ARGUMENT: s = "Error, invalid argument"; break;
+    case ERML_ERROR_NOT_SUPPORTED: s = "Error, not supported"; break;
+    case ERML_ERROR_LIBRARY_NOT_FOUND: s = "Error, library not found"; break;
+    case ERML_ERROR_INVALID_ERROR_CODE: s = "Error, invalid error code"; break;
+    case ERML_ERROR_DRIVER_NOT_LOADED: s = "Error, driver not loaded"; break;
+    case ERML_ERROR_ESL_PORT_NUMBER_ERR: s = "Error, esl port number error"; break;
+    case ERML_ERROR_INVALID_INPUT: s = "Error, invalid input"; break;
+    case ERML_ERROR_FUNCTION_NOT_FOUND: s = "Error, function not found"; break;
+    case ERML_ERROR_OPEN_DRIVER_VERSION: s = "Error, open driver version"; break;
+    case ERML_ERROR_DRIVER_NOT_COMPATIBLE: s = "Error, driver not compatible"; break;
+    case ERML_ERROR_NO_DEVICE: s = "Error, no device"; break;
+    case ERML_ERROR_TIMEOUT: s = "Error, timeout"; break;
+    case ERML_ERROR_FAIL: s = "Error, fail"; break;
+    default: s = "Error, invalid error code"; break;
+    }
+    snprintf(p_error_str, MAX_CHAR_BUFF_LEN, "%s", s);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDriverVer(char *p_driver_ver) {
+    ENTER();
+    OUT(p_driver_ver);
+    set_str(p_driver_ver, "stub-%u.0", ERML_STUB_VERSION);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetLibVer(char *p_self_ver) {
+    ENTER();
+    OUT(p_self_ver);
+    set_str(p_self_ver, "stub-%u.0", ERML_STUB_VERSION);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDriverAccessPoint(char *p_enrigin_driver_ap) {
+    ENTER();
+    OUT(p_enrigin_driver_ap);
+    const char *sysfs = getenv("ERML_STUB_SYSFS");
+    if (sysfs != NULL && *sysfs != '\0') {
+        snprintf(p_enrigin_driver_ap, MAX_CHAR_BUFF_LEN, "%s/", sysfs);
+        return ERML_SUCCESS;
+    }
+    set_str(p_enrigin_driver_ap, "/sys/module/enrigin%.0u", 0);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevCount(uint32_t *dev_count) {
+    ENTER();
+    OUT(dev_count);
+    *dev_count = ctl->dev_count;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetVdevCount(uint32_t dev_idx, uint32_t *vdev_count) {
+    DEV(dev_idx);
+    OUT(vdev_count);
+    *vdev_count = d->vdev_count;
+    return ERML_SUCCESS;
+}
+
+// fill_list copies n entries of size bytes to dst. A non-zero *count is the
+// capacity of dst, the true count is always reported back.
+static void fill_list(void *dst, const void *src, uint32_t n, size_t size, uint32_t *count) {
+    uint32_t cap = *count;
+    if (cap == 0 || cap > n) {
+        cap = n;
+    }
+    memcpy(dst, src, cap * size);
+    *count = n;
+}
+
+ermlReturn_t ErmlGetVdevList(uint32_t dev_idx, uint32_t *vdev_ids, uint32_t *count) {
+    DEV(dev_idx);
+    OUT(vdev_ids);
+    OUT(count);
+    uint32_t n = d->vdev_count < ERML_STUB_MAX_VDEVS ? d->vdev_count : ERML_STUB_MAX_VDEVS;
+    fill_list(vdev_ids, d->vdevs, n, sizeof(uint32_t), count);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetMaxVdevCount(uint32_t dev_idx, uint32_t *vdev_count) {
+    DEV(dev_idx);
+    OUT(vdev_count);
+    (void)d;
+    *vdev_count = ERML_STUB_MAX_VDEVS;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevName(uint32_t dev_idx, char *p_name) {
+    DEV(dev_idx);
+    OUT(p_name);
+    (void)d;
+    set_str(p_name, "GCU-STUB-%u", dev_idx);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevTemp(uint32_t dev_idx, ermlDevThermalInfo_t *p_temp) {
+    DEV(dev_idx);
+    OUT(p_temp);
+    *p_temp = (ermlDevThermalInfo_t){d->temp.cur_asic_temp, d->temp.cur_mem_temp, d->temp.cur_mem_temp};
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevTempV2(uint32_t dev_idx, ermlDevThermalInfoV2_t *p_temp) {
+    DEV(dev_idx);
+    OUT(p_temp);
+    *p_temp = d->temp;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevVolt(uint32_t dev_idx, ermlDevVoltInfo_t *p_volt) {
+    DEV(dev_idx);
+    OUT(p_volt);
+    (void)d;
+    *p_volt = (ermlDevVoltInfo_t){0.75f, 0.8f, 1.1f, 1.8f, 0.9f};
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevPwr(uint32_t dev_idx, ermlDevPowerInfo_t *p_pwr) {
+    DEV(dev_idx);
+    OUT(p_pwr);
+    *p_pwr = d->pwr;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevDpmLevel(uint32_t dev_idx, uint32_t *p_dpm) {
+    DEV(dev_idx);
+    OUT(p_dpm);
+    (void)d;
+    *p_dpm = 0;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevMem(uint32_t dev_idx, ermlDevMemInfo_t *p_mem) {
+    DEV(dev_idx);
+    OUT(p_mem);
+    *p_mem = (ermlDevMemInfo_t){d->hbm_total, d->hbm_used};
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevDtuUsage(uint32_t dev_idx, float *p_data) {
+    DEV(dev_idx);
+    OUT(p_data);
+    *p_data = d->dtu_usage;
+    return ERML_SUCCESS;
+}
+
+static bool has_vdev(const ermlStubDev_t *d, uint32_t vdev_idx) {
+    for (uint32_t i = 0; i < d->vdev_count && i < ERML_STUB_MAX_VDEVS; i++) {
+        if (d->vdevs[i] == vdev_idx) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ermlReturn_t ErmlGetVdevMem(uint32_t dev_idx, uint32_t vdev_idx, ermlDevMemInfo_t *p_mem) {
+    DEV(dev_idx);
+    OUT(p_mem);
+    if (!has_vdev(d, vdev_idx)) {
+        return ERML_ERROR_INVALID_ARGUMENT;
+    }
+    *p_mem = (ermlDevMemInfo_t){d->hbm_total / d->vdev_count, d->hbm_used / d->vdev_count};
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetVdevDtuUsage(uint32_t dev_idx, uint32_t vdev_idx, float *p_data) {
+    DEV(dev_idx);
+    OUT(p_data);
+    if (!has_vdev(d, vdev_idx)) {
+        return ERML_ERROR_INVALID_ARGUMENT;
+    }
+    *p_data = d->dtu_usage;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevDtuUsageAsync(uint32_t dev_idx, float *p_data) {
+    return ErmlGetDevDtuUsage(dev_idx, p_data);
+}
+
+ermlReturn_t ErmlGetDevIsLowPowerMode(uint32_t dev_idx, bool *is_low_power_mode) {
+    DEV(dev_idx);
+    OUT(is_low_power_mode);
+    (void)d;
+    *is_low_power_mode = false;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevIsHealth(uint32_t dev_idx, bool *is_health) {
+    DEV(dev_idx);
+    OUT(is_health);
+    *is_health = d->healthy;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlSetDevSupportLowPower(uint32_t dev_idx, bool enable_low_power_support) {
+    DEV(dev_idx);
+    (void)d;
+    (void)enable_low_power_support;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevSupportLowPower(uint32_t dev_idx, bool *is_support_low_power) {
+    DEV(dev_idx);
+    OUT(is_support_low_power);
+    (void)d;
+    *is_support_low_power = false;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlSetDevSupportPowerStock(uint32_t dev_idx, bool enable_power_stock_support) {
+    DEV(dev_idx);
+    (void)d;
+    (void)enable_power_stock_support;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevSupportPowerStock(uint32_t dev_idx, bool *is_support_power_stock) {
+    DEV(dev_idx);
+    OUT(is_support_power_stock);
+    (void)d;
+    *is_support_power_stock = false;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetMaxFreq(uint32_t dev_idx, uint32_t *max_freq_mhz) {
+    DEV(dev_idx);
+    OUT(max_freq_mhz);
+    *max_freq_mhz = d->clk.cur_dtu_clock;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlSetMaxFreq(uint32_t dev_idx, uint32_t max_freq_mhz) {
+    DEV(dev_idx);
+    d->clk.cur_dtu_clock = max_freq_mhz;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevClk(uint32_t dev_idx, ermlDevClkInfo_t *p_clk) {
+    DEV(dev_idx);
+    OUT(p_clk);
+    *p_clk = d->clk;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetMemClk(uint32_t dev_idx, uint32_t *p_clk_mhz) {
+    DEV(dev_idx);
+    OUT(p_clk_mhz);
+    *p_clk_mhz = d->clk.cur_hbm_clock;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlDumpDevList(void) {
+    ENTER();
+    for (uint32_t i = 0; i < ctl->dev_count; i++) {
+        printf("gcu%u: bus %02x healthy %d\n", i, ctl->devs[i].bus_id, ctl->devs[i].healthy);
+    }
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevInfo(uint32_t dev_idx, ermlDeviceInfo_t *p_info) {
+    DEV(dev_idx);
+    OUT(p_info);
+    memset(p_info, 0, sizeof(*p_info));
+    set_str(p_info->name, "GCU-STUB-%u", dev_idx);
+    p_info->vendor_id = 0x1e36;
+    p_info->device_id = 0xc033;
+    p_info->bus_id = d->bus_id;
+    p_info->logic_id = dev_idx;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevParentInfo(uint32_t dev_idx, ermlDeviceInfo_t *p_info) {
+    return ErmlGetDevInfo(dev_idx, p_info);
+}
+
+ermlReturn_t ErmlDisplayDevTop(uint32_t dev_idx) {
+    DEV(dev_idx);
+    printf("gcu%u: dtu %.1f%% hbm %u/%lu MiB\n", dev_idx, d->dtu_usage, d->hbm_used,
+           (unsigned long)d->hbm_total);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetFwVersion(uint32_t dev_idx, char *fw_ver) {
+    DEV(dev_idx);
+    OUT(fw_ver);
+    (void)d;
+    set_str(fw_ver, "stub-fw-%u.0", ERML_STUB_VERSION);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevUuid(uint32_t dev_idx, char *p_info) {
+    DEV(dev_idx);
+    OUT(p_info);
+    (void)d;
+    set_str(p_info, "stub-%08x", dev_idx);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevSn(uint32_t dev_idx, char *p_sn) {
+    DEV(dev_idx);
+    OUT(p_sn);
+    (void)d;
+    set_str(p_sn, "SN%08u", dev_idx);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevPn(uint32_t dev_idx, char *p_pn) {
+    DEV(dev_idx);
+    OUT(p_pn);
+    (void)d;
+    set_str(p_pn, "PN-STUB-%u", ERML_STUB_VERSION);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevMfd(uint32_t dev_idx, char *p_date) {
+    DEV(dev_idx);
+    OUT(p_date);
+    (void)d;
+    set_str(p_date, "%u-01-01", 2025);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevSKU(uint32_t dev_idx, char *p_info) {
+    DEV(dev_idx);
+    OUT(p_info);
+    (void)d;
+    set_str(p_info, "STUB-SKU-%u", ERML_STUB_VERSION);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetHwArch(uint32_t dev_idx, ermlHwArch_t *p_arch) {
+    DEV(dev_idx);
+    OUT(p_arch);
+    (void)d;
+    *p_arch = GCU310;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetHwArchName(uint32_t dev_idx, char *arch_name) {
+    DEV(dev_idx);
+    OUT(arch_name);
+    (void)d;
+    set_str(arch_name, "GCU%u", 310);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetCableQualify(uint32_t dev_idx, ermlCableQualifySts_t *p_sts) {
+    DEV(dev_idx);
+    OUT(p_sts);
+    (void)d;
+    *p_sts = CABLE_QUALIFIED;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetPerfMode(uint32_t dev_idx, ermlPerfMode_t *p_mode, uint32_t *kfc_lvl) {
+    DEV(dev_idx);
+    OUT(p_mode);
+    OUT(kfc_lvl);
+    (void)d;
+    *p_mode = PERFORMANCE_USER_MODE;
+    *kfc_lvl = 0;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlSetPerfMode(uint32_t dev_idx, ermlPerfMode_t mode, uint32_t kfc_lvl) {
+    DEV(dev_idx);
+    (void)d;
+    (void)kfc_lvl;
+    return mode < PERFORMANCE_MODE_MAX ? ERML_SUCCESS : ERML_ERROR_INVALID_ARGUMENT;
+}
+
+ermlReturn_t ErmlGetDevSlotNum(uint32_t dev_idx, uint32_t *p_slot) {
+    DEV(dev_idx);
+    OUT(p_slot);
+    (void)d;
+    *p_slot = dev_idx;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevSlotOamName(uint32_t dev_idx, char *p_slot_oam) {
+    DEV(dev_idx);
+    OUT(p_slot_oam);
+    (void)d;
+    set_str(p_slot_oam, "OAM%u", dev_idx);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlSelDevByIndex(uint32_t dev_idx) {
+    DEV(dev_idx);
+    (void)d;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetPcieLinkSpeed(uint32_t dev_idx, ermlPcieSpeed_t *p_link_speed) {
+    DEV(dev_idx);
+    OUT(p_link_speed);
+    *p_link_speed = d->link.link_speed;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetPcieLinkWidth(uint32_t dev_idx, ermlPcieWidth_t *p_link_width) {
+    DEV(dev_idx);
+    OUT(p_link_width);
+    *p_link_width = d->link.link_width;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetPcieLinkInfo(uint32_t dev_idx, ermlPcieLinkInfo_t *p_link_info) {
+    DEV(dev_idx);
+    OUT(p_link_info);
+    *p_link_info = d->link;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetPcieThroughput(uint32_t dev_idx, ermlPcieThroughputInfo_t *p_info) {
+    DEV(dev_idx);
+    OUT(p_info);
+    *p_info = d->pcie;
+    return ERML_SUCCESS;
+}
+
+// reset raises the events a real reset does, the device stays usable
+static ermlReturn_t reset(uint32_t dev_idx) {
+    DEV(dev_idx);
+    (void)d;
+    push_event(dev_idx, ERML_EVENT_DTU_RESET_START, "reset start");
+    push_event(dev_idx, ERML_EVENT_DTU_RESET_FINISH, "reset finish");
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlPcieHotReset(uint32_t dev_idx) {
+    return reset(dev_idx);
+}
+
+ermlReturn_t ErmlPcieHotResetV2(uint32_t dev_idx, bool is_force) {
+    (void)is_force;
+    return reset(dev_idx);
+}
+
+ermlReturn_t ErmlPcieHotResetV3(uint32_t dev_idx) {
+    return reset(dev_idx);
+}
+
+ermlReturn_t ErmlPcieFLR(uint32_t dev_idx, bool is_force) {
+    (void)is_force;
+    return reset(dev_idx);
+}
+
+ermlReturn_t ErmlGetPciePhysicalSlotID(uint32_t dev_idx, uint32_t *p_id) {
+    DEV(dev_idx);
+    OUT(p_id);
+    (void)d;
+    *p_id = dev_idx;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevTop(uint32_t dev_idx) {
+    return ErmlDisplayDevTop(dev_idx);
+}
+
+ermlReturn_t ErmlGetEccStatus(uint32_t dev_idx, uint32_t *status) {
+    DEV(dev_idx);
+    OUT(status);
+    *status = d->ecc.enabled;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetEslPortNum(uint32_t dev_idx, uint32_t *p_data) {
+    DEV(dev_idx);
+    OUT(p_data);
+    *p_data = d->esl_port_num;
+    return ERML_SUCCESS;
+}
+
+static ermlReturn_t esl_port(const ermlStubDev_t *d, uint32_t port_id) {
+    if (port_id >= d->esl_port_num || port_id >= ERML_STUB_MAX_ESL_PORTS) {
+        return ERML_ERROR_ESL_PORT_NUMBER_ERR;
+    }
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetEslPortInfo(uint32_t dev_idx, uint32_t port_id, ermlEslPortInfo_t *p_info) {
+    DEV(dev_idx);
+    OUT(p_info);
+    ermlReturn_t r = esl_port(d, port_id);
+    if (r != ERML_SUCCESS) {
+        return r;
+    }
+    memset(p_info, 0, sizeof(*p_info));
+    p_info->vendor_id = 0x1e36;
+    p_info->device_id = 0xc033;
+    p_info->bus_id = d->bus_id;
+    p_info->port_id = port_id;
+    p_info->port_type = ERML_ESL_PORT_RC;
+    int32_t remote = d->esl_remote[port_id];
+    if (remote >= 0 && (uint32_t)remote < ctl->dev_count) {
+        p_info->connected = 1;
+        p_info->remote_card_id = (uint32_t)remote;
+        p_info->remote_vendor_id = 0x1e36;
+        p_info->remote_device_id = 0xc033;
+        p_info->remote_bus_id = ctl->devs[remote].bus_id;
+        p_info->remote_port_type = ERML_ESL_PORT_EP;
+    }
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetEslLinkInfo(uint32_t dev_idx, uint32_t port_id, ermlEslLinkInfo_t *p_info) {
+    DEV(dev_idx);
+    OUT(p_info);
+    ermlReturn_t r = esl_port(d, port_id);
+    if (r != ERML_SUCCESS) {
+        return r;
+    }
+    *p_info = (ermlEslLinkInfo_t){ERML_ESL_LINK_SPEED_GEN5, ERML_ESL_LINK_SPEED_GEN5,
+                                  ERML_ESL_LINK_WIDTH_X8, ERML_ESL_LINK_WIDTH_X8};
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetEslDtuId(uint32_t dev_idx, uint32_t *p_data) {
+    DEV(dev_idx);
+    OUT(p_data);
+    (void)d;
+    *p_data = dev_idx;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetEslIsSupported(uint32_t dev_idx, bool *is_esl_supported) {
+    DEV(dev_idx);
+    OUT(is_esl_supported);
+    *is_esl_supported = d->esl_port_num > 0;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetEslThroughput(uint32_t dev_idx, uint32_t port_id, ermlEslThroughputInfo_t *p_info) {
+    DEV(dev_idx);
+    OUT(p_info);
+    ermlReturn_t r = esl_port(d, port_id);
+    if (r != ERML_SUCCESS) {
+        return r;
+    }
+    memset(p_info, 0, sizeof(*p_info));
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetPGCount(uint32_t dev_idx, uint32_t *pg_count) {
+    DEV(dev_idx);
+    OUT(pg_count);
+    *pg_count = d->pg_count;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevPGUsage(uint32_t dev_idx, uint32_t pg_idx, float *p_data) {
+    DEV(dev_idx);
+    OUT(p_data);
+    if (pg_idx >= d->pg_count) {
+        return ERML_ERROR_INVALID_ARGUMENT;
+    }
+    *p_data = d->dtu_usage;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevPGUsageAsync(uint32_t dev_idx, uint32_t pg_idx, float *p_data) {
+    return ErmlGetDevPGUsage(dev_idx, pg_idx, p_data);
+}
+
+ermlReturn_t ErmlGetClusterCount(uint32_t dev_idx, uint32_t *cluster_count) {
+    DEV(dev_idx);
+    OUT(cluster_count);
+    *cluster_count = d->cluster_count;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevClusterUsage(uint32_t dev_idx, uint32_t cluster_idx, float *p_data) {
+    DEV(dev_idx);
+    OUT(p_data);
+    if (cluster_idx >= d->cluster_count) {
+        return ERML_ERROR_INVALID_ARGUMENT;
+    }
+    *p_data = d->dtu_usage;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevClusterHbmMem(uint32_t dev_idx, uint32_t cluster_idx, ermlClusterHbmMemInfo_t *p_mem) {
+    DEV(dev_idx);
+    OUT(p_mem);
+    if (cluster_idx >= d->cluster_count) {
+        return ERML_ERROR_INVALID_ARGUMENT;
+    }
+    *p_mem = (ermlClusterHbmMemInfo_t){d->hbm_total / d->cluster_count, d->hbm_used / d->cluster_count};
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevHealth(uint32_t dev_idx, bool *health) {
+    return ErmlGetDevIsHealth(dev_idx, health);
+}
+
+ermlReturn_t ErmlGetDevEccStatus(uint32_t dev_idx, ermlEccStatus_t *p_status) {
+    DEV(dev_idx);
+    OUT(p_status);
+    *p_status = d->ecc;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevRmaStatus(uint32_t dev_idx, ermlRmaStatus_t *p_status) {
+    DEV(dev_idx);
+    OUT(p_status);
+    *p_status = (ermlRmaStatus_t){true, d->rma_flag};
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevRmaDetails(uint32_t dev_idx, ermlRmaDetails_t *p_details) {
+    DEV(dev_idx);
+    OUT(p_details);
+    *p_details = (ermlRmaDetails_t){true, d->rma_flag, d->ecc.ecnt_db};
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevLogicId(uint32_t dev_idx, uint32_t *p_logic_id) {
+    DEV(dev_idx);
+    OUT(p_logic_id);
+    (void)d;
+    *p_logic_id = dev_idx;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetDevDecoderCap(uint32_t dev_idx, ermlDecoderCap_t *p_decoder_cap) {
+    DEV(dev_idx);
+    OUT(p_decoder_cap);
+    (void)d;
+    *p_decoder_cap = (ermlDecoderCap_t){32, 4096, 60};
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlSetDevEccMode(uint32_t dev_idx, bool enable) {
+    DEV(dev_idx);
+    d->ecc.enabled = enable;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlHbmScanMode(uint32_t dev_idx, ermlHbmScanType_t op_type) {
+    DEV(dev_idx);
+    (void)d;
+    return op_type == ERML_HBM_SCAN_START ? ERML_SUCCESS : ERML_ERROR_INVALID_ARGUMENT;
+}
+
+ermlReturn_t ErmlGetDevIsVdtuEnabled(uint32_t dev_idx, bool *is_vdtu_enabled) {
+    DEV(dev_idx);
+    OUT(is_vdtu_enabled);
+    *is_vdtu_enabled = d->vdev_count > 0;
+    return ERML_SUCCESS;
+}
+
+// ErmlGetEvent polls the events ring, a negative timeout waits forever
+ermlReturn_t ErmlGetEvent(int timeout_ms, ermlEvent_t *p_event) {
+    ENTER();
+    OUT(p_event);
+    struct timespec tick = {0, 1000000};
+    for (int waited = 0;; waited++) {
+        uint32_t tail = __atomic_load_n(&ctl->event_tail, __ATOMIC_ACQUIRE);
+        uint32_t head = __atomic_load_n(&ctl->event_head, __ATOMIC_ACQUIRE);
+        if (tail != head) {
+            // a controller that ran a full ring ahead loses the oldest events
+            if (head - tail > ERML_STUB_MAX_EVENTS) {
+                tail = head - ERML_STUB_MAX_EVENTS;
+            }
+            *p_event = ctl->events[tail % ERML_STUB_MAX_EVENTS];
+            __atomic_store_n(&ctl->event_tail, tail + 1, __ATOMIC_RELEASE);
+            return ERML_SUCCESS;
+        }
+        if (timeout_ms >= 0 && waited >= timeout_ms) {
+            return ERML_ERROR_TIMEOUT;
+        }
+        nanosleep(&tick, NULL);
+    }
+}
+
+ermlReturn_t ErmlStartListenEvent(uint32_t dev_idx) {
+    DEV(dev_idx);
+    (void)d;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlSwitchOperateSpace(ermlOperateSpace_t opsp) {
+    ENTER();
+    return opsp <= OP_SPACE_CTL ? ERML_SUCCESS : ERML_ERROR_INVALID_ARGUMENT;
+}
+
+ermlReturn_t ErmlGetProcessInfo(uint32_t dev_idx, uint32_t *process_count, ermlProcessInfo_t *p_info) {
+    DEV(dev_idx);
+    OUT(process_count);
+    OUT(p_info);
+    uint32_t n = d->proc_count < ERML_STUB_MAX_PROCS ? d->proc_count : ERML_STUB_MAX_PROCS;
+    fill_list(p_info, d->procs, n, sizeof(ermlProcessInfo_t), process_count);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetNumaNode(uint32_t dev_idx, int *numa_node) {
+    DEV(dev_idx);
+    OUT(numa_node);
+    *numa_node = d->numa_node;
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetSriovPfName(uint32_t dev_idx, char *pf_name) {
+    DEV(dev_idx);
+    OUT(pf_name);
+    (void)d;
+    set_str(pf_name, "gcu%u", dev_idx);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetAffinityCpuList(uint32_t dev_idx, char *cpu_list) {
+    DEV(dev_idx);
+    OUT(cpu_list);
+    set_str(cpu_list, d->numa_node == 0 ? "0-31%.0u" : "32-63%.0u", 0);
+    return ERML_SUCCESS;
+}
+
+ermlReturn_t ErmlGetGcuVirtStatus(uint32_t dev_idx, ermlGcuVirtMode_t *virt_mode) {
+    DEV(dev_idx);
+    OUT(virt_mode);
+    *virt_mode = d->vdev_count > 0 ? ERML_GCU_VIRT_MODE_VGCU : ERML_GCU_VIRT_MODE_HOST;
+    return ERML_SUCCESS;
+}
@@ -0,0 +1,79 @@
+/////////////////////////////////////////////////////////////////////////////
+//  @brief Control file of the liberml stub
+//
+//  The stub maps this layout from $ERML_STUB_CTL, /dev/shm/erml-stub.ctl by
+//  default, shared with any process that wants to change the values, the
+//  latencies or the failures while the plugin runs. A file that does not
+//  exist or carries another magic or version is initialized with
+//  $ERML_STUB_DEVICES healthy devices, 8 by default, each carrying
+//  $ERML_STUB_VDEVS virtual GCUs, none by default. The driver access
+//  point is $ERML_STUB_SYSFS when set, a directory holding the sysfs
+//  attributes of the devices under their PCI addresses.
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef ERML_STUB_H_
+#define ERML_STUB_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "erml.h"
+
+#define ERML_STUB_MAGIC   0x45524d4cu  // "ERML"
+#define ERML_STUB_VERSION 1u
+
+#define ERML_STUB_MAX_DEVS      64
+#define ERML_STUB_MAX_CLUSTERS  64
+#define ERML_STUB_MAX_PGS       16
+#define ERML_STUB_MAX_ESL_PORTS 16
+#define ERML_STUB_MAX_VDEVS     32
+#define ERML_STUB_MAX_PROCS     1024
+#define ERML_STUB_MAX_EVENTS    64
+
+typedef struct {
+    uint32_t latency_ns;  // added to every call on the device
+    int32_t  fail_code;   // returned by every call on the device when set
+    bool     healthy;
+    int32_t  numa_node;
+    uint32_t bus_id;
+
+    float    dtu_usage;
+    uint64_t hbm_total;   // MiB
+    uint32_t hbm_used;    // MiB
+    ermlDevThermalInfoV2_t temp;
+    ermlDevPowerInfo_t     pwr;
+    ermlDevClkInfo_t       clk;
+    ermlPcieLinkInfo_t     link;
+    ermlPcieThroughputInfo_t pcie;
+    ermlEccStatus_t        ecc;
+    bool                   rma_flag;
+
+    uint32_t cluster_count;
+    uint32_t pg_count;
+    uint32_t esl_port_num;
+    int32_t  esl_remote[ERML_STUB_MAX_ESL_PORTS];  // remote card, -1 if none
+
+    uint32_t vdev_count;
+    uint32_t vdevs[ERML_STUB_MAX_VDEVS];  // os indexes
+
+    uint32_t          proc_count;
+    ermlProcessInfo_t procs[ERML_STUB_MAX_PROCS];
+} ermlStubDev_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dev_count;
+    uint32_t latency_ns;  // added to every call
+    int32_t  fail_code;   // returned by every call but ErmlErrorString when set
+
+    // events ring, the controller writes at event_head, ErmlGetEvent reads
+    // at event_tail
+    uint32_t    event_head;
+    uint32_t    event_tail;
+    ermlEvent_t events[ERML_STUB_MAX_EVENTS];
+
+    ermlStubDev_t devs[ERML_STUB_MAX_DEVS];
+} ermlStubCtl_t;
+
+#endif  // ERML_STUB_H_
@@ -12,3 +12,80 @@ const (
 	DeviceName		 string = "gcu"
 	ConnectTimeout        = time.Second * 5
 )
+
+// virtual GCUs are advertised as their own resource
+const (
+	VgcuResourceName string = "jiangyuan.com/vgcu"
+	VgcuDeviceSocket string = "jiangyuan-vgcu.sock"
+	VgcuEnvName      string = "ALLOCATED_JY_VGCU_DEVICES"
+)
+
+const (
+	// ReconcileInterval is the period of the full device rescan, kept as a
+	// fallback for state changes not reported by erml events
+	ReconcileInterval = time.Minute * 5
+	// EventPollTimeout is the pause before waiting for erml events again
+	// after a driver error
+	EventPollTimeout = time.Second
+	// EventWaitTimeout bounds a single blocking wait for an erml event. The
+	// wait holds the erml session, so it is kept short enough not to stall
+	// a re-initialization.
+	EventWaitTimeout = time.Millisecond * 50
+)
+
+// CoalesceWindow is the default time ListAndWatch waits for further device
+// changes before sending an update to kubelet
+const CoalesceWindow = time.Millisecond * 200
+
+const (
+	// MetricsAddr is the default listen address of the /metrics endpoint
+	MetricsAddr = ":9400"
+	// MetricsInterval is the default period of the device telemetry sampling
+	MetricsInterval = time.Second * 10
+	// UsageInterval is the default period of the async usage sampling
+	UsageInterval = time.Second
+	// UsageWindow is the default window of the exported usage statistics
+	UsageWindow = time.Minute
+)
+
+const (
+	// HeartbeatInterval is the default period of the firmware heartbeat
+	// sampling
+	HeartbeatInterval = time.Second
+	// HeartbeatStalls is the default number of consecutive samples without
+	// a heartbeat after which a device is considered hung
+	HeartbeatStalls = 5
+	// HealthInterval is the default period of the health rule evaluation
+	HealthInterval = time.Second * 10
+	// HealthRaise and HealthClear are the default number of consecutive
+	// samples a rule needs to worsen or to lift a device level
+	HealthRaise = 2
+	HealthClear = 5
+	// PcieNakPerSecond is the PCIe NAK rate above which a device is degraded
+	PcieNakPerSecond = 100
+)
+
+// MaxReplicas caps how many containers may time-slice one card
+const MaxReplicas = 16
+
+// AllocCacheSize caps how many device sets keep a prebuilt Allocate response
+const AllocCacheSize = 4096
+
+const (
+	// MemLimitEnvName carries the HBM budget of a container allocated
+	// memory slices, in bytes per card, e.g. "1:2147483648,2:19327352832"
+	MemLimitEnvName string = "JY_GPU_MEM_LIMIT"
+	// MemUnit is the unit erml reports device and process memory in
+	MemUnit = 1 << 20
+	// MemCheckInterval is the default period of the slice budget check
+	MemCheckInterval = time.Second * 10
+)
+
+const (
+	// ProcRoot is the procfs mount the device processes are resolved in,
+	// the plugin runs with hostPID
+	ProcRoot = "/proc"
+	// ProcessInterval is the default period of the per-container process
+	// accounting
+	ProcessInterval = time.Second * 10
+)
@@ -0,0 +1,127 @@
+package erml
+
+import (
+	"sync"
+)
+
+// Device is the per-device API the plugin and the exporters rely on.
+// Handle implements it over liberml, the sim package in memory.
+type Device interface {
+	Index() uint
+	Resolve() error
+	GetBdf() (string, error)
+	GetDevInfo() (*DeviceInfo, error)
+	GetDevIsHealth() (bool, error)
+	GetDevMem() (*DevMemInfo, error)
+	GetClusterCount() (uint, error)
+	GetDevClusterHbmMem(cluster_idx uint) (*ClusterHbmMemInfo, error)
+	GetDevEccStatus() (*DevEccStatus, error)
+	GetDevRmaDetails() (*DevRmaDetails, error)
+	GetDevTempV2() (*DevThermalInfoV2, error)
+	GetPcieLinkInfo() (*LinkInfo, error)
+	GetPcieThroughput() (*ThroughputInfo, error)
+	GetSsmFwHeartBeat() (uint, error)
+	GetEslPortNum() (uint, error)
+	GetEslPortInfo(port_id uint) (*EslPortInfo, error)
+	GetNumaNode() (int, error)
+	GetDevDtuUsageAsync() (float32, error)
+	GetDevPGCount() (uint, error)
+	GetPGUsageAsync(pg_idx uint) (float32, error)
+	AppendVdevList(dst []uint) ([]uint, error)
+	GetVdevDtuMem(vdev_idx uint) (*DevMemInfo, error)
+	GetVdevDtuUsage(vdev_idx uint) (float32, error)
+	AppendProcessInfo(dst []ProcessInfo) ([]ProcessInfo, error)
+	StartListenEvent() error
+	Snapshot(mask SnapshotMask) (*DevSnapshot, error)
+}
+
+// Backend is the library the devices are reached through, liberml unless
+// SetBackend installed another one, e.g. a simulator
+type Backend interface {
+	Init(noDriver bool) error
+	Shutdown() error
+	GetDevCount() (uint, error)
+	Device(dev_idx uint) Device
+	GetEvent(timeout_ms int) (*EventInfo, error)
+	SnapshotAll(mask SnapshotMask, dst []DevSnapshot) ([]DevSnapshot, error)
+}
+
+var backend struct {
+	sync.RWMutex
+	b Backend
+}
+
+func init() {
+	backend.b = ermlBackend{}
+}
+
+// SetBackend replaces liberml, it must be called before the first session
+// is opened
+func SetBackend(b Backend) {
+	backend.Lock()
+	defer backend.Unlock()
+	backend.b = b
+}
+
+func current() Backend {
+	backend.RLock()
+	defer backend.RUnlock()
+	return backend.b
+}
+
+// DeviceByIndex returns the device of dev_idx in the current backend
+func DeviceByIndex(dev_idx uint) Device {
+	return current().Device(dev_idx)
+}
+
+// DeviceCount returns the number of devices of the current backend
+func DeviceCount() (uint, error) {
+	return current().GetDevCount()
+}
+
+// WaitEvent waits up to timeout_ms for a device event of the current
+// backend
+func WaitEvent(timeout_ms int) (*EventInfo, error) {
+	return current().GetEvent(timeout_ms)
+}
+
+/*
+ * @brief Read the fields of mask of every device of the current backend.
+ *
+ * The result reuses dst and the slices of its entries when large enough,
+ * a periodic sampler can pass the previous result back in.
+ */
+func SnapshotAll(mask SnapshotMask, dst []DevSnapshot) ([]DevSnapshot, error) {
+	return current().SnapshotAll(mask, dst)
+}
+
+// ermlBackend reaches the devices through liberml
+type ermlBackend struct{}
+
+func (ermlBackend) Init(noDriver bool) error {
+	return InitV2(noDriver)
+}
+
+func (ermlBackend) Shutdown() error {
+	return Shutdown()
+}
+
+func (ermlBackend) GetDevCount() (uint, error) {
+	return GetDevCount()
+}
+
+func (ermlBackend) Device(dev_idx uint) Device {
+	return Handle{Dev_Idx: dev_idx}
+}
+
+func (ermlBackend) GetEvent(timeout_ms int) (*EventInfo, error) {
+	return GetEvent(timeout_ms)
+}
+
+func (ermlBackend) SnapshotAll(mask SnapshotMask, dst []DevSnapshot) ([]DevSnapshot, error) {
+	return snapshotAll(mask, dst)
+}
+
+func (h Handle) Index() uint {
+	return h.Dev_Idx
+}
@@ -0,0 +1,145 @@
+package erml
+
+import (
+	"bufio"
+	"fmt"
+	"os"
+	"strconv"
+	"strings"
+	"sync"
+)
+
+// devPaths is the sysfs location of a device, resolved through cgo once and
+// reused by every sysfs read until the device is invalidated
+type devPaths struct {
+	bdf      string // dddd:bb:dd.f
+	busPath  string // driver access point joined with bdf
+	logicId  uint
+	logicErr error
+	major    uint
+	minor    uint
+	devErr   error // reading the char device numbers failed
+
+	// attributes polled at a high rate, kept open
+	heartbeat *sysfsAttr // ssm/count
+	sleep     *sysfsAttr // ssm/status
+	state     *sysfsAttr // device_state
+}
+
+func (p *devPaths) close() {
+	p.heartbeat.close()
+	p.sleep.close()
+	p.state.close()
+}
+
+var pathCache = struct {
+	sync.RWMutex
+	devs map[uint]*devPaths
+}{devs: make(map[uint]*devPaths)}
+
+// InvalidateDevice drops the cached paths of a device, to be called when it
+// is reset or hot-plugged
+func InvalidateDevice(dev_idx uint) {
+	pathCache.Lock()
+	p := pathCache.devs[dev_idx]
+	delete(pathCache.devs, dev_idx)
+	pathCache.Unlock()
+	if p != nil {
+		p.close()
+	}
+}
+
+// InvalidateDevices drops the cached paths of every device
+func InvalidateDevices() {
+	pathCache.Lock()
+	devs := pathCache.devs
+	pathCache.devs = make(map[uint]*devPaths)
+	pathCache.Unlock()
+	for _, p := range devs {
+		p.close()
+	}
+}
+
+// Resolve looks the sysfs location of the device up ahead of the first
+// sysfs read
+func (h Handle) Resolve() error {
+	_, err := h.paths()
+	return err
+}
+
+func (h Handle) paths() (*devPaths, error) {
+	pathCache.RLock()
+	p, ok := pathCache.devs[h.Dev_Idx]
+	pathCache.RUnlock()
+	if ok {
+		return p, nil
+	}
+
+	p, err := h.resolvePaths()
+	if err != nil {
+		return nil, err
+	}
+	pathCache.Lock()
+	if cur, ok := pathCache.devs[h.Dev_Idx]; ok {
+		// resolved concurrently, keep the published one
+		pathCache.Unlock()
+		p.close()
+		return cur, nil
+	}
+	pathCache.devs[h.Dev_Idx] = p
+	pathCache.Unlock()
+	return p, nil
+}
+
+func (h Handle) resolvePaths() (*devPaths, error) {
+	devInfo, err := h.GetDevInfo()
+	if err != nil {
+		return nil, err
+	}
+	driverAP, err := GetDriverAccessPoint()
+	if err != nil {
+		return nil, err
+	}
+
+	p := &devPaths{
+		bdf: fmt.Sprintf("%04x:%02x:%02x.%x", devInfo.Domain_Id, devInfo.Bus_Id, devInfo.Dev_Id, devInfo.Func_Id),
+	}
+	p.busPath = driverAP + p.bdf
+	p.heartbeat = newSysfsAttr(p.busPath + "/ssm/count")
+	p.sleep = newSysfsAttr(p.busPath + "/ssm/status")
+	p.state = newSysfsAttr(p.busPath + "/device_state")
+	p.logicId, p.logicErr = h.GetLogicId()
+	if p.logicErr != nil {
+		p.devErr = p.logicErr
+	} else {
+		p.major, p.minor, p.devErr = readMajorMain(p.busPath + "/enrigin/gcu" + strconv.Itoa(int(p.logicId)) + "/dev")
+	}
+	return p, nil
+}
+
+func readMajorMain(filePath string) (major uint, main uint, err error) {
+	file, err := os.Open(filePath)
+	if err != nil {
+		return 0, 0, err
+	}
+	defer file.Close()
+	reader := bufio.NewReader(file)
+
+	line, _, err := reader.ReadLine()
+	slice := strings.Split(string(line), ":")
+	if len(slice) != 2 {
+		return 0, 0, fmt.Errorf("unexpected device number %q in %s", line, filePath)
+	}
+	ma, _ := strconv.Atoi(slice[0])
+	mi, _ := strconv.Atoi(slice[1])
+	return uint(ma), uint(mi), err
+}
+
+// GetBdf returns the PCI address of the device, dddd:bb:dd.f
+func (h Handle) GetBdf() (string, error) {
+	p, err := h.paths()
+	if err != nil {
+		return "", err
+	}
+	return p.bdf, nil
+}
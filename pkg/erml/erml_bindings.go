@@ -18,7 +18,6 @@ import (
 	"os"
 	"os/signal"
 	"strconv"
-	"strings"
 	"syscall"
 )
 
@@ -79,6 +78,14 @@ type EventInfo struct {
 	Msg  string
 }
 
+// event types reported in EventInfo.Type
+const (
+	EventUnknown     uint = 0
+	EventDtuSuspend  uint = 3
+	EventResetStart  uint = 10
+	EventResetFinish uint = 11
+)
+
 type LinkInfo struct {
 	Link_Speed     uint
 	Max_Link_Speed uint
@@ -227,18 +234,11 @@ func (h Handle) GetLogicId() (uint, error) {
 }
 
 func (h Handle) GetBusId() (path string, err error) {
-
-	path = ""
-	devInfo, err := h.GetDevInfo()
+	p, err := h.paths()
 	if err != nil {
-		return
-	}
-	driverAP, err := GetDriverAccessPoint()
-
-	if err == nil {
-		path = fmt.Sprintf("%s%04x:%02x:%02x.%x", driverAP, devInfo.Domain_Id, devInfo.Bus_Id, devInfo.Dev_Id, devInfo.Func_Id)
+		return "", err
 	}
-	return
+	return p.busPath, nil
 }
 
 /*
@@ -405,6 +405,9 @@ func (h Handle) GetDevTempV2() (thermalInfo *DevThermalInfoV2, err error) {
 	} else {
 		var thermalV1 *DevThermalInfo
 		thermalV1, err = h.GetDevTemp()
+		if thermalV1 == nil {
+			return nil, err
+		}
 		thermalInfo = &DevThermalInfoV2{
 			Cur_Asic_Temp:  thermalV1.Cur_Dev_Temp,
 			Cur_Mem_Temp:   thermalV1.Cur_Hbm0_Temp,
@@ -991,88 +994,37 @@ func (h Handle) GetEslThroughput(port_id uint) (throughputInfo *ThroughputInfo,
 }
 
 func (h Handle) GetSsmFwHeartBeat() (count uint, err error) {
-	filePath, _ := h.GetBusId()
-	filePath += "/ssm/count"
-	if _, err := os.Lstat(filePath); err == nil {
-		file, err := os.Open(filePath)
-		if err != nil {
-			fmt.Println("can't open file:", err.Error())
-			return 0, err
-		}
-		defer file.Close()
-
-		reader := bufio.NewReader(file)
-		line, _, err := reader.ReadLine()
-		ssm_count, _ := strconv.Atoi(string(line))
-		return uint(ssm_count), err
-	} else {
+	p, err := h.paths()
+	if err != nil {
 		return 0, err
 	}
+	v, err := p.heartbeat.readUint()
+	return uint(v), err
 }
 
 func (h Handle) GetDevMajorMain() (major uint, main uint, err error) {
-	bus_id_path, _ := h.GetBusId()
-	logic_id, err := h.GetLogicId()
+	p, err := h.paths()
 	if err != nil {
 		return 0, 0, err
 	}
-	filePath := bus_id_path + "/enrigin/gcu" + strconv.Itoa(int(logic_id)) + "/dev"
-	if _, err := os.Lstat(filePath); err == nil {
-		file, err := os.Open(filePath)
-		if err != nil {
-			fmt.Println("can't open file:", err.Error())
-			return 0, 0, err
-		}
-		defer file.Close()
-		reader := bufio.NewReader(file)
-
-		line, _, err := reader.ReadLine()
-		slice := strings.Split(string(line), ":")
-		major, _ := strconv.Atoi(slice[0])
-		main, _ := strconv.Atoi(slice[1])
-		return uint(major), uint(main), err
-	} else {
-		return 0, 0, err
-	}
+	return p.major, p.minor, p.devErr
 }
 
 func (h Handle) GetDevState() (state string, err error) {
-	filePath, _ := h.GetBusId()
-	filePath += "/device_state"
-	if _, err := os.Lstat(filePath); err == nil {
-		file, err := os.Open(filePath)
-		if err != nil {
-			fmt.Println("can't open file:", err.Error())
-			return "", err
-		}
-		defer file.Close()
-		reader := bufio.NewReader(file)
-
-		line, _, err := reader.ReadLine()
-		return string(line), err
-	} else {
+	p, err := h.paths()
+	if err != nil {
 		return "", err
 	}
+	return p.state.readString()
 }
 
 func (h Handle) GetDevInSleepMode() (sleep uint, err error) {
-	filePath, _ := h.GetBusId()
-	filePath += "/ssm/status"
-	if _, err := os.Lstat(filePath); err == nil {
-		file, err := os.Open(filePath)
-		if err != nil {
-			fmt.Println("can't open file:", err.Error())
-			return 0, err
-		}
-		defer file.Close()
-		r := bufio.NewReader(file)
-
-		line, _, err := r.ReadLine()
-		sleep, _ := strconv.Atoi(string(line))
-		return uint(sleep), err
-	} else {
+	p, err := h.paths()
+	if err != nil {
 		return 0, err
 	}
+	v, err := p.sleep.readUint()
+	return uint(v), err
 }
 
 func GetDeviceHandleByIndex(dev_idx uint) (Handle, error) {
@@ -1104,6 +1056,19 @@ func (h Handle) GetDevPn() (string, error) {
 	return C.GoString(&devPn[0]), errorString(r)
 }
 
+/*
+ * @brief Enrigin Management Library get device numa node.
+ */
+func (h Handle) GetNumaNode() (int, error) {
+	var node C.int
+	r := C.ErmlGetNumaNode(C.uint(h.Dev_Idx), &node)
+	if r == C.ERML_ERROR_NOT_SUPPORTED {
+		return -1, errorString(r)
+	}
+
+	return int(node), errorString(r)
+}
+
 /*
  * @brief Enrigin Management Library get the total number of virtual devices per device.
  */
@@ -1118,21 +1083,23 @@ func (h Handle) GetVdevCount() (uint, error) {
 }
 
 /*
- * @brief Enrigin Management Library get virtual devices index in os.
+ * @brief Enrigin Management Library get the maximum number of virtual devices per device.
  */
-func (h Handle) GetVdevList() (vdevList []uint, err error) {
-	var count C.uint32_t
-	var vDevIds [32]C.uint32_t
-	r := C.ErmlGetVdevList(C.uint(h.Dev_Idx), &vDevIds[0], &count)
-	err = errorString(r)
+func (h Handle) GetMaxVdevCount() (uint, error) {
+	var vdev_cnt C.uint32_t
+	r := C.ErmlGetMaxVdevCount(C.uint(h.Dev_Idx), &vdev_cnt)
 	if r == C.ERML_ERROR_NOT_SUPPORTED {
-		return nil, err
-	}
-	for i := uint(0); i < uint(count); i++ {
-		vdevList = append(vdevList, uint(vDevIds[i]))
+		return 0, errorString(r)
 	}
 
-	return
+	return uint(vdev_cnt), errorString(r)
+}
+
+/*
+ * @brief Enrigin Management Library get virtual devices index in os.
+ */
+func (h Handle) GetVdevList() ([]uint, error) {
+	return h.AppendVdevList(nil)
 }
 
 /*
@@ -1171,18 +1138,6 @@ func (h Handle) GetVdevDtuUsage(vdev_idx uint) (float32, error) {
 /*
  * @brief Enrigin Management Library get process info on device.
  */
-func (h Handle) GetProcessInfo() (pInfos []ProcessInfo, err error) {
-	var count C.uint32_t
-	var processInfos [64]C.ermlProcessInfo_t
-	r := C.ErmlGetProcessInfo(C.uint(h.Dev_Idx), &count, &processInfos[0])
-	err = errorString(r)
-	for i := uint(0); i < uint(count); i++ {
-		pInfos = append(pInfos, ProcessInfo{
-			Pid:         uint(processInfos[i].pid),
-			DevMemUsage: uint64(processInfos[i].dev_mem_usage),
-			SysMemUsage: uint64(processInfos[i].sys_mem_usage),
-		})
-	}
-
-	return
+func (h Handle) GetProcessInfo() ([]ProcessInfo, error) {
+	return h.AppendProcessInfo(nil)
 }
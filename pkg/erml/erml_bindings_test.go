@@ -0,0 +1,157 @@
+package erml
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+// TestMain runs against the liberml stub of hack/erml-stub, with its control
+// file and the sysfs attributes of device 0 in a temporary directory. The
+// stub gives device 0 one virtual GCU, numbered after the cards.
+func TestMain(m *testing.M) {
+	os.Exit(runStub(m))
+}
+
+func runStub(m *testing.M) int {
+	dir, err := os.MkdirTemp("", "erml")
+	if err != nil {
+		panic(err)
+	}
+	defer os.RemoveAll(dir)
+
+	bus := filepath.Join(dir, "sysfs", "0000:01:00.0")
+	for name, content := range map[string]string{
+		"ssm/count":        "1024\n",
+		"ssm/status":       "0\n",
+		"ssm/chipid":       "stub-chip-0\n",
+		"device_state":     "normal\n",
+		"enrigin/gcu0/dev": "236:0\n",
+	} {
+		path := filepath.Join(bus, name)
+		if err := os.MkdirAll(filepath.Dir(path), 0755); err != nil {
+			panic(err)
+		}
+		if err := os.WriteFile(path, []byte(content), 0644); err != nil {
+			panic(err)
+		}
+	}
+	os.Setenv("ERML_STUB_CTL", filepath.Join(dir, "erml-stub.ctl"))
+	os.Setenv("ERML_STUB_SYSFS", filepath.Join(dir, "sysfs"))
+	os.Setenv("ERML_STUB_VDEVS", "1")
+
+	if err := InitV2(false); err != nil {
+		panic(err)
+	}
+	defer Shutdown()
+	ids, err := Handle{Dev_Idx: 0}.GetVdevList()
+	if err != nil || len(ids) == 0 {
+		panic(fmt.Sprintf("device 0 has no vdev: %v", err))
+	}
+	vdev = ids[0]
+	return m.Run()
+}
+
+// the list getters append to buffers reused across calls, as the samplers do
+var (
+	vdev  uint // first vdev of device 0
+	vdevs = make([]uint, 0, 32)
+	procs = make([]ProcessInfo, 0, 64)
+)
+
+// getters calls every getter of a handle, the sysfs ones included
+var getters = []struct {
+	name string
+	call func(h Handle) error
+}{
+	{"GetBdf", func(h Handle) (err error) { _, err = h.GetBdf(); return }},
+	{"GetLogicId", func(h Handle) (err error) { _, err = h.GetLogicId(); return }},
+	{"GetBusId", func(h Handle) (err error) { _, err = h.GetBusId(); return }},
+	{"GetClusterCount", func(h Handle) (err error) { _, err = h.GetClusterCount(); return }},
+	{"GetDevName", func(h Handle) (err error) { _, err = h.GetDevName(); return }},
+	{"GetDevSlotOamName", func(h Handle) (err error) { _, err = h.GetDevSlotOamName(); return }},
+	{"GetDevTemp", func(h Handle) (err error) { _, err = h.GetDevTemp(); return }},
+	{"GetDevTempV2", func(h Handle) (err error) { _, err = h.GetDevTempV2(); return }},
+	{"GetDevPwr", func(h Handle) (err error) { _, err = h.GetDevPwr(); return }},
+	{"GetDevDpmLevel", func(h Handle) (err error) { _, err = h.GetDevDpmLevel(); return }},
+	{"GetDevMem", func(h Handle) (err error) { _, err = h.GetDevMem(); return }},
+	{"GetDevDtuUsage", func(h Handle) (err error) { _, err = h.GetDevDtuUsage(); return }},
+	{"GetDevDtuUsageAsync", func(h Handle) (err error) { _, err = h.GetDevDtuUsageAsync(); return }},
+	{"GetClusterUsage", func(h Handle) (err error) { _, err = h.GetClusterUsage(0); return }},
+	{"GetDevClusterHbmMem", func(h Handle) (err error) { _, err = h.GetDevClusterHbmMem(0); return }},
+	{"GetDevHealth", func(h Handle) (err error) { _, err = h.GetDevHealth(); return }},
+	{"GetDevIsHealth", func(h Handle) (err error) { _, err = h.GetDevIsHealth(); return }},
+	{"GetDevClk", func(h Handle) (err error) { _, err = h.GetDevClk(); return }},
+	{"GetDevInfo", func(h Handle) (err error) { _, err = h.GetDevInfo(); return }},
+	{"GetFwVersion", func(h Handle) (err error) { _, err = h.GetFwVersion(); return }},
+	{"GetDevPGCount", func(h Handle) (err error) { _, err = h.GetDevPGCount(); return }},
+	{"GetPGUsage", func(h Handle) (err error) { _, err = h.GetPGUsage(0); return }},
+	{"GetPGUsageAsync", func(h Handle) (err error) { _, err = h.GetPGUsageAsync(0); return }},
+	{"GetDevUuidFromErml", func(h Handle) (err error) { _, err = h.GetDevUuidFromErml(); return }},
+	{"GetDevUuidFromDriver", func(h Handle) (err error) { _, err = h.GetDevUuidFromDriver(); return }},
+	{"GetPcieLinkSpeed", func(h Handle) (err error) { _, err = h.GetPcieLinkSpeed(); return }},
+	{"GetHwArch", func(h Handle) (err error) { _, err = h.GetHwArch(); return }},
+	{"GetPcieLinkWidth", func(h Handle) (err error) { _, err = h.GetPcieLinkWidth(); return }},
+	{"GetPcieLinkInfo", func(h Handle) (err error) { _, err = h.GetPcieLinkInfo(); return }},
+	{"GetPcieThroughput", func(h Handle) (err error) { _, err = h.GetPcieThroughput(); return }},
+	{"GetDevRmaStatus", func(h Handle) (err error) { _, err = h.GetDevRmaStatus(); return }},
+	{"GetDevRmaDetails", func(h Handle) (err error) { _, err = h.GetDevRmaDetails(); return }},
+	{"GetDevEccStatus", func(h Handle) (err error) { _, err = h.GetDevEccStatus(); return }},
+	{"GetEslPortNum", func(h Handle) (err error) { _, err = h.GetEslPortNum(); return }},
+	{"GetEslPortInfo", func(h Handle) (err error) { _, err = h.GetEslPortInfo(0); return }},
+	{"GetEslLinkInfo", func(h Handle) (err error) { _, err = h.GetEslLinkInfo(0); return }},
+	{"GetEslDtuId", func(h Handle) (err error) { _, err = h.GetEslDtuId(); return }},
+	{"GetEslThroughput", func(h Handle) (err error) { _, err = h.GetEslThroughput(0); return }},
+	{"GetSsmFwHeartBeat", func(h Handle) (err error) { _, err = h.GetSsmFwHeartBeat(); return }},
+	{"GetDevMajorMain", func(h Handle) (err error) { _, _, err = h.GetDevMajorMain(); return }},
+	{"GetDevState", func(h Handle) (err error) { _, err = h.GetDevState(); return }},
+	{"GetDevInSleepMode", func(h Handle) (err error) { _, err = h.GetDevInSleepMode(); return }},
+	{"GetDevSKU", func(h Handle) (err error) { _, err = h.GetDevSKU(); return }},
+	{"GetDevSn", func(h Handle) (err error) { _, err = h.GetDevSn(); return }},
+	{"GetDevPn", func(h Handle) (err error) { _, err = h.GetDevPn(); return }},
+	{"GetNumaNode", func(h Handle) (err error) { _, err = h.GetNumaNode(); return }},
+	{"GetVdevCount", func(h Handle) (err error) { _, err = h.GetVdevCount(); return }},
+	{"GetMaxVdevCount", func(h Handle) (err error) { _, err = h.GetMaxVdevCount(); return }},
+	{"GetVdevList", func(h Handle) (err error) { _, err = h.GetVdevList(); return }},
+	{"GetVdevDtuMem", func(h Handle) (err error) { _, err = h.GetVdevDtuMem(vdev); return }},
+	{"GetVdevDtuUsage", func(h Handle) (err error) { _, err = h.GetVdevDtuUsage(vdev); return }},
+	{"GetProcessInfo", func(h Handle) (err error) { _, err = h.GetProcessInfo(); return }},
+	{"AppendVdevList", func(h Handle) (err error) { _, err = h.AppendVdevList(vdevs[:0]); return }},
+	{"AppendProcessInfo", func(h Handle) (err error) { _, err = h.AppendProcessInfo(procs[:0]); return }},
+	{"Snapshot", func(h Handle) (err error) { _, err = h.Snapshot(SnapAll); return }},
+}
+
+func TestGetters(t *testing.T) {
+	h := Handle{Dev_Idx: 0}
+	for _, g := range getters {
+		if err := g.call(h); err != nil {
+			t.Errorf("%s: %v", g.name, err)
+		}
+	}
+	if state, err := h.GetDevState(); err != nil || state != "normal" {
+		t.Errorf("GetDevState: got %q %v, want normal", state, err)
+	}
+	if major, minor, err := h.GetDevMajorMain(); err != nil || major != 236 || minor != 0 {
+		t.Errorf("GetDevMajorMain: got %d:%d %v, want 236:0", major, minor, err)
+	}
+}
+
+// BenchmarkGetters times every getter of device 0, the sysfs paths are
+// resolved once before
+func BenchmarkGetters(b *testing.B) {
+	h := Handle{Dev_Idx: 0}
+	if err := h.Resolve(); err != nil {
+		b.Fatal(err)
+	}
+	for _, g := range getters {
+		b.Run(g.name, func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if err := g.call(h); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
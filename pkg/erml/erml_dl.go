@@ -14,6 +14,7 @@ import (
 /*
 #include <dlfcn.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include "erml.h"
 */
@@ -30,7 +31,9 @@ func (dl *dl_handle_ptr) InitV2(noDriver bool) C.ermlReturn_t {
 	var handle unsafe.Pointer
 	for _, path := range searchPaths {
 		for _, name := range searchNames {
-			handle = C.dlopen(C.CString(path+name), C.int(openFlags))
+			cname := C.CString(path + name)
+			handle = C.dlopen(cname, C.int(openFlags))
+			C.free(unsafe.Pointer(cname))
 			if handle != C.NULL {
 				dl.handles = append(dl.handles, handle)
 				return C.ErmlInit(C.bool(noDriver))
@@ -43,7 +46,9 @@ func (dl *dl_handle_ptr) InitV2(noDriver bool) C.ermlReturn_t {
 func (dl *dl_handle_ptr) Shutdown() C.ermlReturn_t {
 	C.ErmlShutdown()
 
-	for _, handle := range dl.handles {
+	handles := dl.handles
+	dl.handles = nil
+	for _, handle := range handles {
 		err := C.dlclose(handle)
 		if err != 0 {
 			return C.ERML_ERROR_FUNCTION_NOT_FOUND
@@ -0,0 +1,99 @@
+/////////////////////////////////////////////////////////////////////////////
+//  @brief Batched telemetry read of the Enrigin Managerment Library
+/////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "erml_snapshot.h"
+
+static void snap_result(ermlDevSnapshot_t *snap, uint32_t field, ermlReturn_t r)
+{
+    if (r == ERML_SUCCESS) {
+        snap->valid |= field;
+    } else if (snap->ret == ERML_SUCCESS) {
+        snap->ret = r;
+    }
+}
+
+static ermlReturn_t snap_temp(uint32_t dev_idx, ermlDevThermalInfoV2_t *temp)
+{
+    ermlReturn_t r = ErmlGetDevTempV2(dev_idx, temp);
+    if (r != ERML_ERROR_NOT_SUPPORTED) {
+        return r;
+    }
+
+    // same mapping as Handle.GetDevTempV2 on GCU200/210
+    ermlDevThermalInfo_t v1;
+    r = ErmlGetDevTemp(dev_idx, &v1);
+    temp->cur_asic_temp  = v1.cur_dev_temp;
+    temp->cur_mem_temp   = v1.cur_hbm0_temp;
+    temp->cur_board_temp = v1.cur_dev_temp;
+    return r;
+}
+
+void ErmlSnapshotDev(uint32_t dev_idx, uint32_t mask, ermlDevSnapshot_t *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+    snap->dev_idx = dev_idx;
+    snap->ret     = ERML_SUCCESS;
+
+    if (mask & ERML_SNAP_USAGE) {
+        snap_result(snap, ERML_SNAP_USAGE, ErmlGetDevDtuUsage(dev_idx, &snap->dtu_usage));
+    }
+    if (mask & ERML_SNAP_MEM) {
+        snap_result(snap, ERML_SNAP_MEM, ErmlGetDevMem(dev_idx, &snap->mem));
+    }
+    if (mask & ERML_SNAP_TEMP) {
+        snap_result(snap, ERML_SNAP_TEMP, snap_temp(dev_idx, &snap->temp));
+    }
+    if (mask & ERML_SNAP_POWER) {
+        snap_result(snap, ERML_SNAP_POWER, ErmlGetDevPwr(dev_idx, &snap->pwr));
+    }
+    if (mask & ERML_SNAP_CLOCK) {
+        snap_result(snap, ERML_SNAP_CLOCK, ErmlGetDevClk(dev_idx, &snap->clk));
+    }
+    if (mask & ERML_SNAP_PCIE) {
+        snap_result(snap, ERML_SNAP_PCIE, ErmlGetPcieThroughput(dev_idx, &snap->pcie));
+    }
+    if (mask & ERML_SNAP_ECC) {
+        snap_result(snap, ERML_SNAP_ECC, ErmlGetDevEccStatus(dev_idx, &snap->ecc));
+    }
+    if (mask & ERML_SNAP_HEALTH) {
+        snap_result(snap, ERML_SNAP_HEALTH, ErmlGetDevIsHealth(dev_idx, &snap->health));
+    }
+    if (mask & ERML_SNAP_CLUSTERS) {
+        ermlReturn_t r = ErmlGetClusterCount(dev_idx, &snap->cluster_count);
+        if (snap->cluster_count > ERML_SNAP_MAX_CLUSTERS) {
+            snap->cluster_count = ERML_SNAP_MAX_CLUSTERS;
+        }
+        for (uint32_t i = 0; r == ERML_SUCCESS && i < snap->cluster_count; i++) {
+            r = ErmlGetDevClusterUsage(dev_idx, i, &snap->cluster_usage[i]);
+            if (r == ERML_SUCCESS) {
+                r = ErmlGetDevClusterHbmMem(dev_idx, i, &snap->cluster_mem[i]);
+            }
+        }
+        snap_result(snap, ERML_SNAP_CLUSTERS, r);
+    }
+    if (mask & ERML_SNAP_ESL) {
+        ermlReturn_t r = ErmlGetEslPortNum(dev_idx, &snap->esl_port_num);
+        if (snap->esl_port_num > ERML_SNAP_MAX_ESL_PORTS) {
+            snap->esl_port_num = ERML_SNAP_MAX_ESL_PORTS;
+        }
+        for (uint32_t i = 0; r == ERML_SUCCESS && i < snap->esl_port_num; i++) {
+            r = ErmlGetEslThroughput(dev_idx, i, &snap->esl[i]);
+        }
+        snap_result(snap, ERML_SNAP_ESL, r);
+    }
+}
+
+ermlReturn_t ErmlSnapshotAll(uint32_t mask, ermlDevSnapshot_t *snaps, uint32_t cap, uint32_t *count)
+{
+    ermlReturn_t r = ErmlGetDevCount(count);
+    if (r != ERML_SUCCESS) {
+        return r;
+    }
+    for (uint32_t i = 0; i < *count && i < cap; i++) {
+        ErmlSnapshotDev(i, mask, &snaps[i]);
+    }
+    return ERML_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/////////////////////////////////////////////////////////////////////////////
+//  @brief Batched telemetry read of the Enrigin Managerment Library
+//
+//  Gathers the requested fields of every device in a single call so Go
+//  crosses cgo once per scrape instead of once per field and device.
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef ERML_SNAPSHOT_H_
+#define ERML_SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "erml.h"
+
+#define ERML_SNAP_MAX_CLUSTERS  64
+#define ERML_SNAP_MAX_ESL_PORTS 16
+
+// fields of ermlDevSnapshot_t, combined into the request mask
+#define ERML_SNAP_USAGE    (1u << 0)
+#define ERML_SNAP_MEM      (1u << 1)
+#define ERML_SNAP_TEMP     (1u << 2)
+#define ERML_SNAP_POWER    (1u << 3)
+#define ERML_SNAP_CLOCK    (1u << 4)
+#define ERML_SNAP_PCIE     (1u << 5)
+#define ERML_SNAP_ECC      (1u << 6)
+#define ERML_SNAP_HEALTH   (1u << 7)
+#define ERML_SNAP_CLUSTERS (1u << 8)
+#define ERML_SNAP_ESL      (1u << 9)
+
+typedef struct {
+    uint32_t     dev_idx;
+    uint32_t     valid;   // fields read successfully
+    ermlReturn_t ret;     // first failure, ERML_SUCCESS if none
+    float        dtu_usage;
+    ermlDevMemInfo_t         mem;
+    ermlDevThermalInfoV2_t   temp;
+    ermlDevPowerInfo_t       pwr;
+    ermlDevClkInfo_t         clk;
+    ermlPcieThroughputInfo_t pcie;
+    ermlEccStatus_t          ecc;
+    bool                     health;
+    uint32_t                 cluster_count;
+    float                    cluster_usage[ERML_SNAP_MAX_CLUSTERS];
+    ermlClusterHbmMemInfo_t  cluster_mem[ERML_SNAP_MAX_CLUSTERS];
+    uint32_t                 esl_port_num;
+    ermlEslThroughputInfo_t  esl[ERML_SNAP_MAX_ESL_PORTS];
+} ermlDevSnapshot_t;
+
+// ErmlSnapshotDev fills snap with the fields of mask for one device
+void ErmlSnapshotDev(uint32_t dev_idx, uint32_t mask, ermlDevSnapshot_t *snap);
+
+// ErmlSnapshotAll fills up to cap devices and stores the device count in
+// *count, the caller retries with a larger array when *count > cap
+ermlReturn_t ErmlSnapshotAll(uint32_t mask, ermlDevSnapshot_t *snaps, uint32_t cap, uint32_t *count);
+
+#endif  // ERML_SNAPSHOT_H_
@@ -0,0 +1,146 @@
+package erml
+
+// #include <stdbool.h>
+// #include "erml.h"
+import "C"
+
+import (
+	"sync"
+)
+
+const (
+	// minProcesses is the initial capacity of a process buffer
+	minProcesses = 256
+	// maxProcesses bounds the growth of a process buffer
+	maxProcesses = 1 << 16
+	// minVdevs is the vdev buffer capacity used when the maximum vdev count
+	// can not be read
+	minVdevs = 32
+	// maxVdevs bounds the growth of a vdev buffer
+	maxVdevs = 1 << 10
+)
+
+// listBuf holds the C side arrays of the list APIs of one device, reused
+// across calls. Neither ErmlGetProcessInfo nor ErmlGetVdevList take the
+// capacity of the array.
+//
+// The vdev array is grown to ErmlGetVdevCount before every list, so it
+// holds all the enabled vdevs whatever the library does with the count.
+//
+// There is no process count query. The count is primed with the capacity
+// of the array and a count reaching it is taken as a possible truncation:
+// the array grows and the call is retried. This relies on liberml reading
+// the primed count as the capacity, as the stub does; erml.h does not
+// document it. A library that ignores it and writes more processes than
+// the array holds overflows it, the bindings can not prevent that.
+type listBuf struct {
+	sync.Mutex
+	procs   []C.ermlProcessInfo_t
+	vdevs   []C.uint32_t
+	enabled C.uint // vdev count, kept here so the call does not allocate it
+}
+
+var listBufs struct {
+	sync.Mutex
+	devs []*listBuf // indexed by device index
+}
+
+func bufFor(dev_idx uint) *listBuf {
+	listBufs.Lock()
+	defer listBufs.Unlock()
+	for uint(len(listBufs.devs)) <= dev_idx {
+		listBufs.devs = append(listBufs.devs, &listBuf{})
+	}
+	return listBufs.devs[dev_idx]
+}
+
+/*
+ * @brief Append the processes running on the device to dst. The C array is
+ * kept per device, reusing dst keeps the steady state free of allocations.
+ * See listBuf for the capacity contract assumed of liberml.
+ */
+func (h Handle) AppendProcessInfo(dst []ProcessInfo) ([]ProcessInfo, error) {
+	buf := bufFor(h.Dev_Idx)
+	buf.Lock()
+	defer buf.Unlock()
+	if len(buf.procs) == 0 {
+		buf.procs = make([]C.ermlProcessInfo_t, minProcesses)
+	}
+
+	var count C.uint32_t
+	for {
+		count = C.uint32_t(len(buf.procs))
+		r := C.ErmlGetProcessInfo(C.uint(h.Dev_Idx), &count, &buf.procs[0])
+		if r != C.ERML_SUCCESS {
+			return dst, errorString(r)
+		}
+		if int(count) < len(buf.procs) || len(buf.procs) >= maxProcesses {
+			break
+		}
+		buf.procs = make([]C.ermlProcessInfo_t, grow(len(buf.procs), int(count), maxProcesses))
+	}
+	if int(count) > len(buf.procs) {
+		count = C.uint32_t(len(buf.procs))
+	}
+	for _, p := range buf.procs[:count] {
+		dst = append(dst, ProcessInfo{
+			Pid:         uint(p.pid),
+			DevMemUsage: uint64(p.dev_mem_usage),
+			SysMemUsage: uint64(p.sys_mem_usage),
+		})
+	}
+	return dst, nil
+}
+
+/*
+ * @brief Append the os indexes of the virtual devices to dst, sized from the
+ * maximum and the enabled vdev counts of the device.
+ */
+func (h Handle) AppendVdevList(dst []uint) ([]uint, error) {
+	buf := bufFor(h.Dev_Idx)
+	buf.Lock()
+	defer buf.Unlock()
+	if len(buf.vdevs) == 0 {
+		n := minVdevs
+		if max, err := h.GetMaxVdevCount(); err == nil && int(max) > n {
+			n = int(max)
+		}
+		buf.vdevs = make([]C.uint32_t, n)
+	}
+	if C.ErmlGetVdevCount(C.uint(h.Dev_Idx), &buf.enabled) == C.ERML_SUCCESS && int(buf.enabled) > len(buf.vdevs) {
+		buf.vdevs = make([]C.uint32_t, buf.enabled)
+	}
+
+	var count C.uint32_t
+	for {
+		count = C.uint32_t(len(buf.vdevs))
+		r := C.ErmlGetVdevList(C.uint(h.Dev_Idx), &buf.vdevs[0], &count)
+		if r != C.ERML_SUCCESS {
+			return dst, errorString(r)
+		}
+		if int(count) < len(buf.vdevs) || len(buf.vdevs) >= maxVdevs {
+			break
+		}
+		buf.vdevs = make([]C.uint32_t, grow(len(buf.vdevs), int(count), maxVdevs))
+	}
+	if int(count) > len(buf.vdevs) {
+		count = C.uint32_t(len(buf.vdevs))
+	}
+	for _, id := range buf.vdevs[:count] {
+		dst = append(dst, uint(id))
+	}
+	return dst, nil
+}
+
+// grow returns the next capacity of a list buffer, at least twice the
+// current one or the count the library asked for, at most limit
+func grow(cur, want, limit int) int {
+	n := cur * 2
+	if want > n {
+		n = want
+	}
+	if n > limit {
+		n = limit
+	}
+	return n
+}
@@ -0,0 +1,120 @@
+package erml
+
+import (
+	"errors"
+	"sync"
+	"sync/atomic"
+)
+
+// Session is a long-lived, reference counted ERML initialization shared by
+// every consumer in the process (device scanner, Allocate path, exporters).
+// The library is loaded and initialized once, and is only re-initialized
+// after a driver level error reported through Do.
+type Session struct {
+	mu       sync.RWMutex
+	refs     int
+	ready    bool
+	noDriver bool
+	inits    atomic.Uint64
+}
+
+var session = &Session{}
+
+// OpenSession returns the process wide session, initializing ERML on first
+// use. Every successful call must be paired with a Close.
+func OpenSession(noDriver bool) (*Session, error) {
+	s := session
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	s.noDriver = noDriver
+	if err := s.initLocked(); err != nil {
+		return nil, err
+	}
+	s.refs++
+	return s, nil
+}
+
+// Close drops one reference, shutting ERML down with the last one.
+func (s *Session) Close() error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	if s.refs == 0 {
+		return nil
+	}
+	s.refs--
+	if s.refs > 0 || !s.ready {
+		return nil
+	}
+	s.ready = false
+	return current().Shutdown()
+}
+
+// Do runs fn against an initialized library. Concurrent calls run in
+// parallel; a driver level error returned by fn marks the session stale so
+// the next call tears ERML down and initializes it again.
+func (s *Session) Do(fn func() error) error {
+	s.mu.RLock()
+	for !s.ready {
+		s.mu.RUnlock()
+		s.mu.Lock()
+		err := s.initLocked()
+		s.mu.Unlock()
+		if err != nil {
+			return err
+		}
+		s.mu.RLock()
+	}
+	inits := s.inits.Load()
+	err := fn()
+	s.mu.RUnlock()
+
+	if IsDriverError(err) {
+		s.invalidate(inits)
+	}
+	return err
+}
+
+// Inits returns how many times ERML has been initialized by this session,
+// it is safe to call from inside Do.
+func (s *Session) Inits() uint64 {
+	return s.inits.Load()
+}
+
+// invalidate marks the session stale unless another caller already
+// re-initialized it since the failing call started.
+func (s *Session) invalidate(inits uint64) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if !s.ready || s.inits.Load() != inits {
+		return
+	}
+	s.ready = false
+	_ = current().Shutdown()
+}
+
+func (s *Session) initLocked() error {
+	if s.ready {
+		return nil
+	}
+	if err := current().Init(s.noDriver); err != nil {
+		_ = current().Shutdown()
+		return err
+	}
+	// devices may come back renumbered after a driver reload
+	InvalidateDevices()
+	s.ready = true
+	s.inits.Add(1)
+	return nil
+}
+
+// IsDriverError reports whether err means the driver or library state is
+// gone and ERML has to be initialized again.
+func IsDriverError(err error) bool {
+	var e ErmlError
+	if !errors.As(err, &e) {
+		return false
+	}
+	return e.ErrCode == ErrDriverNotLoad.ErrCode || e.ErrCode == ErrUnInit.ErrCode
+}
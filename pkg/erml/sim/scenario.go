@@ -0,0 +1,139 @@
+package sim
+
+import (
+	"encoding/json"
+	"fmt"
+	"os"
+	"time"
+
+	"github.com/pkg/errors"
+)
+
+// Scenario describes the simulated node: its devices, the events they
+// raise and the faults injected into them, all timed from the first Init
+type Scenario struct {
+	Devices []DeviceSpec `json:"devices"`
+	Events  []EventSpec  `json:"events"`
+	Faults  []FaultSpec  `json:"faults"`
+	// Latency is added to every device call, to model a slow driver
+	Latency Duration `json:"latency"`
+	// Manual freezes the clock, it only moves through Sim.Advance, so a run
+	// does not depend on the wall time
+	Manual bool `json:"manual"`
+}
+
+// DeviceSpec describes Count identical devices
+type DeviceSpec struct {
+	Count    int    `json:"count"` // defaults to 1
+	Name     string `json:"name"`
+	Numa     int    `json:"numa"`
+	Clusters int    `json:"clusters"`
+	HbmMiB   uint   `json:"hbm_mib"`
+	// EslPorts links the devices of the entry into a ring, port 0 to the
+	// next device and port 1 to the previous one
+	EslPorts  int           `json:"esl_ports"`
+	PGs       int           `json:"pgs"`
+	Vdevs     int           `json:"vdevs"`
+	Usage     float32       `json:"usage"` // DTU usage, percent
+	Processes []ProcessSpec `json:"processes"`
+}
+
+type ProcessSpec struct {
+	Pid    uint   `json:"pid"`
+	MemMiB uint64 `json:"mem_mib"`
+}
+
+// EventSpec raises an erml event, a reset is reported as a reset start at
+// At and a reset finish For later, the device is unhealthy in between
+type EventSpec struct {
+	At     Duration `json:"at"`
+	For    Duration `json:"for"`
+	Device uint     `json:"device"`
+	Type   string   `json:"type"` // reset or suspend
+}
+
+// FaultSpec degrades a device, or every device when Device is negative,
+// from At for For, forever when For is zero
+type FaultSpec struct {
+	At     Duration `json:"at"`
+	For    Duration `json:"for"`
+	Device int      `json:"device"`
+	Kind   string   `json:"kind"`
+	// Rate is the SBE per minute of an ecc fault and the NAK per second of
+	// a nak fault
+	Rate float64 `json:"rate"`
+	// Temp is the asic temperature of a thermal fault
+	Temp float32 `json:"temp"`
+}
+
+// fault kinds
+const (
+	FaultUnhealthy      = "unhealthy"       // erml reports the device unhealthy
+	FaultHeartbeatStall = "heartbeat_stall" // the firmware heartbeat stops
+	FaultEcc            = "ecc"             // correctable errors at Rate per minute
+	FaultDbe            = "dbe"             // one uncorrectable error, RMA flagged
+	FaultThermal        = "thermal"         // asic at Temp
+	FaultLinkDegraded   = "link_degraded"   // PCIe link at half width
+	FaultNak            = "nak"             // PCIe NAKs at Rate per second
+	FaultDriverLost     = "driver_lost"     // every call fails until re-initialized
+)
+
+// event types
+const (
+	EventReset   = "reset"
+	EventSuspend = "suspend"
+)
+
+// Duration reads a time.Duration from a string such as "1m30s"
+type Duration time.Duration
+
+func (d *Duration) UnmarshalJSON(b []byte) error {
+	var s string
+	if err := json.Unmarshal(b, &s); err != nil {
+		return err
+	}
+	v, err := time.ParseDuration(s)
+	if err != nil {
+		return err
+	}
+	*d = Duration(v)
+	return nil
+}
+
+func (d Duration) MarshalJSON() ([]byte, error) {
+	return json.Marshal(time.Duration(d).String())
+}
+
+// Load reads a scenario file
+func Load(path string) (*Scenario, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return nil, errors.WithMessage(err, "read scenario failed")
+	}
+	sc := &Scenario{}
+	if err := json.Unmarshal(data, sc); err != nil {
+		return nil, errors.WithMessagef(err, "parse scenario %s failed", path)
+	}
+	return sc, sc.validate()
+}
+
+func (sc *Scenario) validate() error {
+	for i, spec := range sc.Devices {
+		if spec.Count < 0 || spec.Clusters < 0 || spec.EslPorts < 0 || spec.PGs < 0 || spec.Vdevs < 0 {
+			return fmt.Errorf("device entry %d: negative count", i)
+		}
+	}
+	for i, f := range sc.Faults {
+		switch f.Kind {
+		case FaultUnhealthy, FaultHeartbeatStall, FaultEcc, FaultDbe, FaultThermal, FaultLinkDegraded, FaultNak, FaultDriverLost:
+		default:
+			return fmt.Errorf("fault %d: unknown kind %q", i, f.Kind)
+		}
+	}
+	for i, e := range sc.Events {
+		if e.Type != EventReset && e.Type != EventSuspend {
+			return fmt.Errorf("event %d: unknown type %q", i, e.Type)
+		}
+	}
+	return nil
+}
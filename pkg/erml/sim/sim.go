@@ -0,0 +1,627 @@
+// Package sim is an in-memory erml backend driven by a Scenario, so the
+// plugin runs, and can be load tested, without a card or liberml.
+package sim
+
+import (
+	"fmt"
+	"sort"
+	"sync"
+	"time"
+
+	"gpu-device-plugin/pkg/erml"
+)
+
+// heartbeatPeriod is the period of the simulated firmware heartbeat
+const heartbeatPeriod = time.Millisecond * 100
+
+// Sim implements erml.Backend. Every value is derived from the scenario
+// and the clock, two runs observing the same clock see the same devices.
+type Sim struct {
+	sc      *Scenario
+	devices []*device
+	events  []event // ordered by time
+
+	mu          sync.Mutex
+	start       time.Time
+	manual      time.Duration // clock of a manual scenario
+	advanced    chan struct{} // closed by the next Advance
+	initialized bool
+	next        int // first undelivered event
+	faults      []FaultSpec
+}
+
+type event struct {
+	at   time.Duration
+	info erml.EventInfo
+}
+
+type device struct {
+	sim   *Sim
+	idx   uint
+	spec  DeviceSpec
+	esl   []int  // remote card per ESL port
+	vdevs []uint // os indexes of the vdevs
+}
+
+// New builds the devices of sc, the clock starts with the first Init
+func New(sc *Scenario) *Sim {
+	s := &Sim{sc: sc, faults: append([]FaultSpec(nil), sc.Faults...), advanced: make(chan struct{})}
+	for _, spec := range sc.Devices {
+		n := spec.Count
+		if n == 0 {
+			n = 1
+		}
+		first := len(s.devices)
+		for i := 0; i < n; i++ {
+			s.devices = append(s.devices, &device{sim: s, idx: uint(len(s.devices)), spec: spec})
+		}
+		if spec.EslPorts > 0 && n > 1 {
+			for i := 0; i < n; i++ {
+				d := s.devices[first+i]
+				d.esl = make([]int, spec.EslPorts)
+				for port := range d.esl {
+					d.esl[port] = -1
+				}
+				d.esl[0] = first + (i+1)%n
+				if spec.EslPorts > 1 {
+					d.esl[1] = first + (i+n-1)%n
+				}
+			}
+		}
+	}
+	// vdevs take the gcu nodes after the cards
+	vdev := uint(len(s.devices))
+	for _, d := range s.devices {
+		for i := 0; i < d.spec.Vdevs; i++ {
+			d.vdevs = append(d.vdevs, vdev)
+			vdev++
+		}
+	}
+	for _, e := range sc.Events {
+		switch e.Type {
+		case EventReset:
+			length := time.Duration(e.For)
+			if length == 0 {
+				length = time.Second
+			}
+			s.events = append(s.events,
+				event{time.Duration(e.At), erml.EventInfo{Id: e.Device, Type: erml.EventResetStart, Msg: "reset start"}},
+				event{time.Duration(e.At) + length, erml.EventInfo{Id: e.Device, Type: erml.EventResetFinish, Msg: "reset finish"}})
+			// the device is unhealthy while it resets
+			s.faults = append(s.faults, FaultSpec{At: e.At, For: Duration(length), Device: int(e.Device), Kind: FaultUnhealthy})
+		case EventSuspend:
+			s.events = append(s.events, event{time.Duration(e.At), erml.EventInfo{Id: e.Device, Type: erml.EventDtuSuspend, Msg: "dtu suspend"}})
+		}
+	}
+	sort.SliceStable(s.events, func(i, j int) bool { return s.events[i].at < s.events[j].at })
+	return s
+}
+
+// Advance moves the clock of a manual scenario and wakes the GetEvent
+// callers up
+func (s *Sim) Advance(d time.Duration) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.manual += d
+	close(s.advanced)
+	s.advanced = make(chan struct{})
+}
+
+// Inject adds a fault starting now, for fuzzing health transitions
+func (s *Sim) Inject(f FaultSpec) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	f.At = Duration(s.nowLocked())
+	s.faults = append(s.faults, f)
+}
+
+func (s *Sim) nowLocked() time.Duration {
+	if s.sc.Manual || s.start.IsZero() {
+		return s.manual
+	}
+	return time.Since(s.start)
+}
+
+// faultsLocked calls fn with every fault of a device active at now, of
+// any device when dev_idx is negative
+func (s *Sim) faultsLocked(dev_idx int, now time.Duration, fn func(f *FaultSpec)) {
+	for i := range s.faults {
+		f := &s.faults[i]
+		if dev_idx >= 0 && f.Device >= 0 && f.Device != dev_idx {
+			continue
+		}
+		if now < time.Duration(f.At) || (f.For > 0 && now >= time.Duration(f.At+f.For)) {
+			continue
+		}
+		fn(f)
+	}
+}
+
+// overlapLocked returns how long faults of kind have been active on a
+// device up to now
+func (s *Sim) overlapLocked(dev_idx int, kind string, now time.Duration, fn func(f *FaultSpec, d time.Duration)) {
+	for i := range s.faults {
+		f := &s.faults[i]
+		if f.Kind != kind || (f.Device >= 0 && f.Device != dev_idx) || now <= time.Duration(f.At) {
+			continue
+		}
+		end := now
+		if f.For > 0 && time.Duration(f.At+f.For) < end {
+			end = time.Duration(f.At + f.For)
+		}
+		fn(f, end-time.Duration(f.At))
+	}
+}
+
+// call gates every device call on the library state and the driver_lost
+// faults, and adds the scenario latency
+func (s *Sim) call() (time.Duration, error) {
+	if s.sc.Latency > 0 {
+		time.Sleep(time.Duration(s.sc.Latency))
+	}
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	now := s.nowLocked()
+	lost := false
+	s.faultsLocked(-1, now, func(f *FaultSpec) {
+		if f.Kind == FaultDriverLost {
+			lost = true
+		}
+	})
+	if lost {
+		// the library has to be initialized again once the driver is back
+		s.initialized = false
+		return now, erml.ErrDriverNotLoad
+	}
+	if !s.initialized {
+		return now, erml.ErrUnInit
+	}
+	return now, nil
+}
+
+func (s *Sim) Init(noDriver bool) error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if s.start.IsZero() {
+		s.start = time.Now()
+	}
+	lost := false
+	s.faultsLocked(-1, s.nowLocked(), func(f *FaultSpec) {
+		if f.Kind == FaultDriverLost {
+			lost = true
+		}
+	})
+	if lost {
+		return erml.ErrDriverNotLoad
+	}
+	s.initialized = true
+	return nil
+}
+
+func (s *Sim) Shutdown() error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.initialized = false
+	return nil
+}
+
+func (s *Sim) GetDevCount() (uint, error) {
+	if _, err := s.call(); err != nil {
+		return 0, err
+	}
+	return uint(len(s.devices)), nil
+}
+
+func (s *Sim) Device(dev_idx uint) erml.Device {
+	if dev_idx < uint(len(s.devices)) {
+		return s.devices[dev_idx]
+	}
+	return &device{sim: s, idx: dev_idx}
+}
+
+// GetEvent returns the next due event, waiting up to timeout_ms for it. A
+// manual clock only moves on Advance, the wait then ends at the deadline
+// or at the next Advance.
+func (s *Sim) GetEvent(timeout_ms int) (*erml.EventInfo, error) {
+	deadline := time.Now().Add(time.Duration(timeout_ms) * time.Millisecond)
+	for {
+		now, err := s.call()
+		if err != nil {
+			return nil, err
+		}
+		s.mu.Lock()
+		if s.next < len(s.events) && s.events[s.next].at <= now {
+			info := s.events[s.next].info
+			s.next++
+			s.mu.Unlock()
+			return &info, nil
+		}
+		wait := time.Until(deadline)
+		if !s.sc.Manual && s.next < len(s.events) && s.events[s.next].at-now < wait {
+			wait = s.events[s.next].at - now
+		}
+		advanced := s.advanced
+		s.mu.Unlock()
+		if wait <= 0 {
+			return nil, erml.ErrTimeout
+		}
+		timer := time.NewTimer(wait)
+		select {
+		case <-timer.C:
+		case <-advanced:
+			timer.Stop()
+		}
+	}
+}
+
+func (s *Sim) SnapshotAll(mask erml.SnapshotMask, dst []erml.DevSnapshot) ([]erml.DevSnapshot, error) {
+	if _, err := s.call(); err != nil {
+		return dst[:0], err
+	}
+	dst = dst[:0]
+	for _, d := range s.devices {
+		snap, _ := d.Snapshot(mask)
+		dst = append(dst, *snap)
+	}
+	return dst, nil
+}
+
+func (d *device) exists() bool {
+	return d.idx < uint(len(d.sim.devices))
+}
+
+// state returns the clock after gating the call, unknown devices fail
+// like an invalid index does in liberml
+func (d *device) state() (time.Duration, error) {
+	now, err := d.sim.call()
+	if err != nil {
+		return now, err
+	}
+	if !d.exists() {
+		return now, erml.ErrInvalidArg
+	}
+	return now, nil
+}
+
+func (d *device) has(now time.Duration, kind string) (f *FaultSpec) {
+	d.sim.mu.Lock()
+	defer d.sim.mu.Unlock()
+	d.sim.faultsLocked(int(d.idx), now, func(active *FaultSpec) {
+		if active.Kind == kind {
+			f = active
+		}
+	})
+	return
+}
+
+func (d *device) Index() uint {
+	return d.idx
+}
+
+func (d *device) Resolve() error {
+	return nil
+}
+
+func (d *device) GetBdf() (string, error) {
+	if _, err := d.state(); err != nil {
+		return "", err
+	}
+	return fmt.Sprintf("0000:%02x:00.0", d.idx+1), nil
+}
+
+func (d *device) GetDevInfo() (*erml.DeviceInfo, error) {
+	if _, err := d.state(); err != nil {
+		return nil, err
+	}
+	name := d.spec.Name
+	if name == "" {
+		name = "sim"
+	}
+	return &erml.DeviceInfo{Name: name, Vendor_Id: 0x1e36, Device_Id: 0xc033, Bus_Id: d.idx + 1}, nil
+}
+
+func (d *device) GetDevIsHealth() (bool, error) {
+	now, err := d.state()
+	if err != nil {
+		return false, err
+	}
+	return d.has(now, FaultUnhealthy) == nil, nil
+}
+
+func (d *device) GetDevMem() (*erml.DevMemInfo, error) {
+	if _, err := d.state(); err != nil {
+		return nil, err
+	}
+	return &erml.DevMemInfo{Mem_Total_Size: d.spec.HbmMiB, Mem_Used: uint(d.usedMiB())}, nil
+}
+
+func (d *device) usedMiB() uint64 {
+	var used uint64
+	for _, p := range d.spec.Processes {
+		used += p.MemMiB
+	}
+	return used
+}
+
+func (d *device) GetClusterCount() (uint, error) {
+	if _, err := d.state(); err != nil {
+		return 0, err
+	}
+	return uint(d.spec.Clusters), nil
+}
+
+func (d *device) GetDevClusterHbmMem(cluster_idx uint) (*erml.ClusterHbmMemInfo, error) {
+	if _, err := d.state(); err != nil {
+		return nil, err
+	}
+	if cluster_idx >= uint(d.spec.Clusters) {
+		return nil, erml.ErrInvalidArg
+	}
+	n := uint(d.spec.Clusters)
+	return &erml.ClusterHbmMemInfo{Mem_Total_Size: d.spec.HbmMiB / n, Mem_Used: uint(d.usedMiB()) / n}, nil
+}
+
+func (d *device) GetDevEccStatus() (*erml.DevEccStatus, error) {
+	now, err := d.state()
+	if err != nil {
+		return nil, err
+	}
+	ecc := &erml.DevEccStatus{Enabled: true}
+	d.sim.mu.Lock()
+	d.sim.overlapLocked(int(d.idx), FaultEcc, now, func(f *FaultSpec, active time.Duration) {
+		ecc.Ecnt_sb += uint(f.Rate * active.Minutes())
+	})
+	d.sim.overlapLocked(int(d.idx), FaultDbe, now, func(*FaultSpec, time.Duration) {
+		ecc.Ecnt_db++
+	})
+	d.sim.mu.Unlock()
+	return ecc, nil
+}
+
+func (d *device) GetDevRmaDetails() (*erml.DevRmaDetails, error) {
+	ecc, err := d.GetDevEccStatus()
+	if err != nil {
+		return nil, err
+	}
+	return &erml.DevRmaDetails{SupportRma: true, Flags: ecc.Ecnt_db > 0, Dbe: ecc.Ecnt_db}, nil
+}
+
+func (d *device) GetDevTempV2() (*erml.DevThermalInfoV2, error) {
+	now, err := d.state()
+	if err != nil {
+		return nil, err
+	}
+	t := &erml.DevThermalInfoV2{Cur_Asic_Temp: 45, Cur_Mem_Temp: 40, Cur_Board_Temp: 35}
+	if f := d.has(now, FaultThermal); f != nil {
+		t.Cur_Asic_Temp = f.Temp
+	}
+	return t, nil
+}
+
+func (d *device) GetPcieLinkInfo() (*erml.LinkInfo, error) {
+	now, err := d.state()
+	if err != nil {
+		return nil, err
+	}
+	link := &erml.LinkInfo{Link_Speed: 4, Max_Link_Speed: 4, Link_Width: 16, Max_Link_Width: 16}
+	if d.has(now, FaultLinkDegraded) != nil {
+		link.Link_Width = 8
+	}
+	return link, nil
+}
+
+func (d *device) GetPcieThroughput() (*erml.ThroughputInfo, error) {
+	now, err := d.state()
+	if err != nil {
+		return nil, err
+	}
+	t := &erml.ThroughputInfo{}
+	d.sim.mu.Lock()
+	d.sim.overlapLocked(int(d.idx), FaultNak, now, func(f *FaultSpec, active time.Duration) {
+		t.Rx_Nak += uint64(f.Rate * active.Seconds())
+	})
+	d.sim.mu.Unlock()
+	return t, nil
+}
+
+// GetSsmFwHeartBeat counts the heartbeat periods not covered by a stall
+func (d *device) GetSsmFwHeartBeat() (uint, error) {
+	now, err := d.state()
+	if err != nil {
+		return 0, err
+	}
+	beating := now
+	d.sim.mu.Lock()
+	d.sim.overlapLocked(int(d.idx), FaultHeartbeatStall, now, func(_ *FaultSpec, active time.Duration) {
+		beating -= active
+	})
+	d.sim.mu.Unlock()
+	if beating < 0 {
+		beating = 0
+	}
+	return uint(beating / heartbeatPeriod), nil
+}
+
+func (d *device) GetEslPortNum() (uint, error) {
+	if _, err := d.state(); err != nil {
+		return 0, err
+	}
+	return uint(d.spec.EslPorts), nil
+}
+
+func (d *device) GetEslPortInfo(port_id uint) (*erml.EslPortInfo, error) {
+	if _, err := d.state(); err != nil {
+		return nil, err
+	}
+	if port_id >= uint(d.spec.EslPorts) {
+		return nil, erml.ErrEslPortNum
+	}
+	port := &erml.EslPortInfo{Port_Id: port_id}
+	if port_id < uint(len(d.esl)) && d.esl[port_id] >= 0 {
+		port.Connected = 1
+		port.Remote_Card_Id = uint(d.esl[port_id])
+	}
+	return port, nil
+}
+
+func (d *device) GetNumaNode() (int, error) {
+	if _, err := d.state(); err != nil {
+		return -1, err
+	}
+	return d.spec.Numa, nil
+}
+
+func (d *device) GetDevDtuUsageAsync() (float32, error) {
+	if _, err := d.state(); err != nil {
+		return 0, err
+	}
+	return d.spec.Usage, nil
+}
+
+func (d *device) GetDevPGCount() (uint, error) {
+	if _, err := d.state(); err != nil {
+		return 0, err
+	}
+	return uint(d.spec.PGs), nil
+}
+
+func (d *device) GetPGUsageAsync(pg_idx uint) (float32, error) {
+	if _, err := d.state(); err != nil {
+		return 0, err
+	}
+	if pg_idx >= uint(d.spec.PGs) {
+		return 0, erml.ErrInvalidArg
+	}
+	return d.spec.Usage, nil
+}
+
+func (d *device) AppendVdevList(dst []uint) ([]uint, error) {
+	if _, err := d.state(); err != nil {
+		return dst, err
+	}
+	return append(dst, d.vdevs...), nil
+}
+
+func (d *device) vdev(vdev_idx uint) bool {
+	for _, v := range d.vdevs {
+		if v == vdev_idx {
+			return true
+		}
+	}
+	return false
+}
+
+func (d *device) GetVdevDtuMem(vdev_idx uint) (*erml.DevMemInfo, error) {
+	if _, err := d.state(); err != nil {
+		return nil, err
+	}
+	if !d.vdev(vdev_idx) {
+		return nil, erml.ErrInvalidArg
+	}
+	return &erml.DevMemInfo{Mem_Total_Size: d.spec.HbmMiB / uint(len(d.vdevs))}, nil
+}
+
+func (d *device) GetVdevDtuUsage(vdev_idx uint) (float32, error) {
+	if _, err := d.state(); err != nil {
+		return 0, err
+	}
+	if !d.vdev(vdev_idx) {
+		return 0, erml.ErrInvalidArg
+	}
+	return d.spec.Usage, nil
+}
+
+func (d *device) AppendProcessInfo(dst []erml.ProcessInfo) ([]erml.ProcessInfo, error) {
+	if _, err := d.state(); err != nil {
+		return dst, err
+	}
+	for _, p := range d.spec.Processes {
+		dst = append(dst, erml.ProcessInfo{Pid: p.Pid, DevMemUsage: p.MemMiB})
+	}
+	return dst, nil
+}
+
+func (d *device) StartListenEvent() error {
+	_, err := d.state()
+	return err
+}
+
+// Snapshot reads every field through the getters, like the C shim does
+// through liberml
+func (d *device) Snapshot(mask erml.SnapshotMask) (*erml.DevSnapshot, error) {
+	snap := &erml.DevSnapshot{Dev_Idx: d.idx}
+	read := func(field erml.SnapshotMask, err error) {
+		if err == nil {
+			snap.Valid |= field
+		} else if snap.Err == nil {
+			snap.Err = err
+		}
+	}
+	if mask&erml.SnapUsage != 0 {
+		var err error
+		snap.Dtu_Usage, err = d.GetDevDtuUsageAsync()
+		read(erml.SnapUsage, err)
+	}
+	if mask&erml.SnapMem != 0 {
+		mem, err := d.GetDevMem()
+		if err == nil {
+			snap.Mem = *mem
+		}
+		read(erml.SnapMem, err)
+	}
+	if mask&erml.SnapTemp != 0 {
+		t, err := d.GetDevTempV2()
+		if err == nil {
+			snap.Thermal = *t
+		}
+		read(erml.SnapTemp, err)
+	}
+	if mask&erml.SnapPower != 0 {
+		_, err := d.state()
+		snap.Power = erml.DevPowerInfo{Pwr_Capability: 300, Cur_Pwr_Consumption: 100 + 2*snap.Dtu_Usage}
+		read(erml.SnapPower, err)
+	}
+	if mask&erml.SnapClock != 0 {
+		_, err := d.state()
+		snap.Clock = erml.DevClkInfo{Cur_Hbm_Clock: 1600, Cur_Dtu_Clock: 1400}
+		read(erml.SnapClock, err)
+	}
+	if mask&erml.SnapPcie != 0 {
+		t, err := d.GetPcieThroughput()
+		if err == nil {
+			snap.Pcie = *t
+		}
+		read(erml.SnapPcie, err)
+	}
+	if mask&erml.SnapEcc != 0 {
+		ecc, err := d.GetDevEccStatus()
+		if err == nil {
+			snap.Ecc = *ecc
+		}
+		read(erml.SnapEcc, err)
+	}
+	if mask&erml.SnapHealth != 0 {
+		var err error
+		snap.Health, err = d.GetDevIsHealth()
+		read(erml.SnapHealth, err)
+	}
+	if mask&erml.SnapClusters != 0 {
+		var err error
+		for c := uint(0); c < uint(d.spec.Clusters) && err == nil; c++ {
+			var mem *erml.ClusterHbmMemInfo
+			if mem, err = d.GetDevClusterHbmMem(c); err == nil {
+				snap.Cluster_Usage = append(snap.Cluster_Usage, d.spec.Usage)
+				snap.Cluster_Mem = append(snap.Cluster_Mem, *mem)
+			}
+		}
+		read(erml.SnapClusters, err)
+	}
+	if mask&erml.SnapEsl != 0 {
+		_, err := d.state()
+		for port := 0; port < d.spec.EslPorts && err == nil; port++ {
+			snap.Esl = append(snap.Esl, erml.ThroughputInfo{})
+		}
+		read(erml.SnapEsl, err)
+	}
+	return snap, snap.Err
+}
@@ -0,0 +1,154 @@
+package erml
+
+// #include "erml_snapshot.h"
+import "C"
+
+import (
+	"sync"
+)
+
+// SnapshotMask selects the fields gathered by Snapshot and SnapshotAll
+type SnapshotMask uint32
+
+const (
+	SnapUsage    SnapshotMask = C.ERML_SNAP_USAGE
+	SnapMem      SnapshotMask = C.ERML_SNAP_MEM
+	SnapTemp     SnapshotMask = C.ERML_SNAP_TEMP
+	SnapPower    SnapshotMask = C.ERML_SNAP_POWER
+	SnapClock    SnapshotMask = C.ERML_SNAP_CLOCK
+	SnapPcie     SnapshotMask = C.ERML_SNAP_PCIE
+	SnapEcc      SnapshotMask = C.ERML_SNAP_ECC
+	SnapHealth   SnapshotMask = C.ERML_SNAP_HEALTH
+	SnapClusters SnapshotMask = C.ERML_SNAP_CLUSTERS
+	SnapEsl      SnapshotMask = C.ERML_SNAP_ESL
+
+	SnapAll = SnapUsage | SnapMem | SnapTemp | SnapPower | SnapClock | SnapPcie |
+		SnapEcc | SnapHealth | SnapClusters | SnapEsl
+)
+
+// DevSnapshot is the telemetry of one device read in a single cgo call.
+// Only the fields flagged in Valid hold data, Err is the first failure.
+type DevSnapshot struct {
+	Dev_Idx       uint
+	Valid         SnapshotMask
+	Err           error
+	Dtu_Usage     float32
+	Mem           DevMemInfo
+	Thermal       DevThermalInfoV2
+	Power         DevPowerInfo
+	Clock         DevClkInfo
+	Pcie          ThroughputInfo
+	Ecc           DevEccStatus
+	Health        bool
+	Cluster_Usage []float32
+	Cluster_Mem   []ClusterHbmMemInfo
+	Esl           []ThroughputInfo // one entry per ESL port
+}
+
+// snapBuf is the C side array reused by SnapshotAll
+var snapBuf struct {
+	sync.Mutex
+	devs []C.ermlDevSnapshot_t
+}
+
+/*
+ * @brief Read the fields of mask of one device in a single cgo call.
+ */
+func (h Handle) Snapshot(mask SnapshotMask) (*DevSnapshot, error) {
+	var snap C.ermlDevSnapshot_t
+	C.ErmlSnapshotDev(C.uint32_t(h.Dev_Idx), C.uint32_t(mask), &snap)
+
+	ret := &DevSnapshot{}
+	ret.fill(&snap)
+	return ret, ret.Err
+}
+
+// snapshotAll reads the fields of mask of every liberml device in a single
+// cgo call
+func snapshotAll(mask SnapshotMask, dst []DevSnapshot) ([]DevSnapshot, error) {
+	snapBuf.Lock()
+	defer snapBuf.Unlock()
+
+	for {
+		var count C.uint32_t
+		devs := snapBuf.devs
+		var first *C.ermlDevSnapshot_t
+		if len(devs) > 0 {
+			first = &devs[0]
+		}
+		r := C.ErmlSnapshotAll(C.uint32_t(mask), first, C.uint32_t(len(devs)), &count)
+		if err := errorString(r); err != nil {
+			return dst[:0], err
+		}
+		if int(count) > len(devs) {
+			snapBuf.devs = make([]C.ermlDevSnapshot_t, count)
+			continue
+		}
+
+		if cap(dst) < int(count) {
+			dst = append(dst[:cap(dst)], make([]DevSnapshot, int(count)-cap(dst))...)
+		}
+		dst = dst[:count]
+		for i := range dst {
+			dst[i].fill(&devs[i])
+		}
+		return dst, nil
+	}
+}
+
+func (s *DevSnapshot) fill(c *C.ermlDevSnapshot_t) {
+	s.Dev_Idx = uint(c.dev_idx)
+	s.Valid = SnapshotMask(c.valid)
+	s.Err = errorString(c.ret)
+	s.Dtu_Usage = float32(c.dtu_usage)
+	s.Mem = DevMemInfo{
+		Mem_Total_Size: uint(c.mem.mem_total_size),
+		Mem_Used:       uint(c.mem.mem_used),
+	}
+	s.Thermal = DevThermalInfoV2{
+		Cur_Asic_Temp:  float32(c.temp.cur_asic_temp),
+		Cur_Mem_Temp:   float32(c.temp.cur_mem_temp),
+		Cur_Board_Temp: float32(c.temp.cur_board_temp),
+	}
+	s.Power = DevPowerInfo{
+		Pwr_Capability:      float32(c.pwr.pwr_capability),
+		Cur_Pwr_Consumption: float32(c.pwr.cur_pwr_consumption),
+	}
+	s.Clock = DevClkInfo{
+		Cur_Hbm_Clock: uint(c.clk.cur_hbm_clock),
+		Cur_Dtu_Clock: uint(c.clk.cur_dtu_clock),
+	}
+	s.Pcie = ThroughputInfo{
+		Tx_Throughput: float32(c.pcie.tx_throughput),
+		Rx_Throughput: float32(c.pcie.rx_throughput),
+		Tx_Nak:        uint64(c.pcie.tx_nak),
+		Rx_Nak:        uint64(c.pcie.rx_nak),
+	}
+	s.Ecc = DevEccStatus{
+		Enabled: bool(c.ecc.enabled),
+		Pending: bool(c.ecc.pending),
+		Pdblack: bool(c.ecc.pdblack),
+		Ecnt_sb: uint(c.ecc.ecnt_sb),
+		Ecnt_db: uint(c.ecc.ecnt_db),
+	}
+	s.Health = bool(c.health)
+
+	s.Cluster_Usage = s.Cluster_Usage[:0]
+	s.Cluster_Mem = s.Cluster_Mem[:0]
+	for i := 0; i < int(c.cluster_count); i++ {
+		s.Cluster_Usage = append(s.Cluster_Usage, float32(c.cluster_usage[i]))
+		s.Cluster_Mem = append(s.Cluster_Mem, ClusterHbmMemInfo{
+			Mem_Total_Size: uint(c.cluster_mem[i].mem_total_size),
+			Mem_Used:       uint(c.cluster_mem[i].mem_used),
+		})
+	}
+	s.Esl = s.Esl[:0]
+	for i := 0; i < int(c.esl_port_num); i++ {
+		s.Esl = append(s.Esl, ThroughputInfo{
+			Tx_Throughput: float32(c.esl[i].tx_throughput),
+			Rx_Throughput: float32(c.esl[i].rx_throughput),
+			Tx_Nak:        uint64(c.esl[i].tx_nak),
+			Rx_Nak:        uint64(c.esl[i].rx_nak),
+		})
+	}
+}
@@ -0,0 +1,116 @@
+package erml
+
+import (
+	"errors"
+	"fmt"
+	"os"
+	"sync"
+	"syscall"
+)
+
+// sysfsAttr reads a sysfs attribute through a file descriptor kept open
+// between reads. sysfs regenerates the content on every read at offset 0,
+// so a pread into the preallocated buffer replaces open, read and close.
+type sysfsAttr struct {
+	mu     sync.Mutex
+	path   string
+	fd     int  // -1 while not open
+	closed bool // the device was invalidated, stop caching the fd
+	buf    [128]byte
+}
+
+func newSysfsAttr(path string) *sysfsAttr {
+	return &sysfsAttr{path: path, fd: -1}
+}
+
+// readUint parses the attribute as a decimal number without allocating
+func (a *sysfsAttr) readUint() (uint64, error) {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+
+	line, err := a.readLocked()
+	if err != nil {
+		return 0, err
+	}
+	if len(line) == 0 {
+		return 0, fmt.Errorf("empty attribute %s", a.path)
+	}
+	var v uint64
+	for _, c := range line {
+		if c < '0' || c > '9' {
+			return 0, fmt.Errorf("unexpected value %q in %s", line, a.path)
+		}
+		v = v*10 + uint64(c-'0')
+	}
+	return v, nil
+}
+
+// readString returns the first line of the attribute
+func (a *sysfsAttr) readString() (string, error) {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+
+	line, err := a.readLocked()
+	return string(line), err
+}
+
+// readLocked returns the first line of the attribute, the slice is only
+// valid until the lock is released. A descriptor left stale by a removed
+// or reset device is reopened once.
+func (a *sysfsAttr) readLocked() ([]byte, error) {
+	n, err := a.preadLocked()
+	if errors.Is(err, syscall.ENODEV) || errors.Is(err, syscall.ESTALE) || errors.Is(err, syscall.EBADF) {
+		a.closeLocked()
+		n, err = a.preadLocked()
+	}
+	if a.closed {
+		a.closeLocked()
+	}
+	if err != nil {
+		return nil, err
+	}
+
+	line := a.buf[:n]
+	for i, c := range line {
+		if c == '\n' {
+			return line[:i], nil
+		}
+	}
+	return line, nil
+}
+
+func (a *sysfsAttr) preadLocked() (int, error) {
+	if a.fd < 0 {
+		fd, err := syscall.Open(a.path, syscall.O_RDONLY|syscall.O_CLOEXEC, 0)
+		if err != nil {
+			return 0, &os.PathError{Op: "open", Path: a.path, Err: err}
+		}
+		a.fd = fd
+	}
+	for {
+		n, err := syscall.Pread(a.fd, a.buf[:], 0)
+		if err == syscall.EINTR {
+			continue
+		}
+		if err != nil {
+			return 0, &os.PathError{Op: "pread", Path: a.path, Err: err}
+		}
+		return n, nil
+	}
+}
+
+func (a *sysfsAttr) closeLocked() {
+	if a.fd >= 0 {
+		_ = syscall.Close(a.fd)
+		a.fd = -1
+	}
+}
+
+// close releases the descriptor, later reads still work but no longer
+// keep it open
+func (a *sysfsAttr) close() {
+	a.mu.Lock()
+	a.closed = true
+	a.closeLocked()
+	a.mu.Unlock()
+}
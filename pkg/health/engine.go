@@ -0,0 +1,158 @@
+package health
+
+import (
+	"strings"
+	"time"
+
+	"gpu-device-plugin/pkg/erml"
+)
+
+// Level grades a device, ordered from best to worst
+type Level int
+
+const (
+	Healthy Level = iota
+	// Degraded devices stay schedulable but are kept out of multi-card
+	// placements
+	Degraded
+	Unhealthy
+)
+
+func (l Level) String() string {
+	switch l {
+	case Healthy:
+		return "Healthy"
+	case Degraded:
+		return "Degraded"
+	default:
+		return "Unhealthy"
+	}
+}
+
+// Verdict is a level with the reasons that led to it
+type Verdict struct {
+	Level  Level
+	Reason string
+}
+
+// Sample is the health related telemetry of a device at one point in time,
+// a nil field could not be read
+type Sample struct {
+	Time    time.Time
+	Ecc     *erml.DevEccStatus
+	Rma     *erml.DevRmaDetails
+	Thermal *erml.DevThermalInfoV2
+	Link    *erml.LinkInfo
+	Pcie    *erml.ThroughputInfo
+}
+
+// Rule rates one aspect of a device. prev is the previous sample of the
+// same device, nil on the first one, so rules can work on rates.
+type Rule interface {
+	Name() string
+	Eval(prev, cur *Sample) Verdict
+}
+
+// DeviceRule is a Rule keeping state per device, the engine calls
+// EvalDevice instead of Eval
+type DeviceRule interface {
+	Rule
+	EvalDevice(id string, prev, cur *Sample) Verdict
+	Forget(id string)
+}
+
+// Engine evaluates the rules on every sample of every device. A rule has to
+// report a worse level for Raise consecutive samples before the device
+// takes it, and a better one for Clear consecutive samples before it is
+// lifted, so a signal hovering around a threshold does not flap the device.
+type Engine struct {
+	rules   []Rule
+	raise   int
+	clear   int
+	devices map[string]*deviceState
+}
+
+type deviceState struct {
+	prev  *Sample
+	rules []ruleState
+}
+
+type ruleState struct {
+	level   Level
+	reason  string
+	pending Level // level seen in the last count samples
+	count   int
+}
+
+func NewEngine(raise, clear int, rules ...Rule) *Engine {
+	return &Engine{
+		rules:   rules,
+		raise:   raise,
+		clear:   clear,
+		devices: make(map[string]*deviceState),
+	}
+}
+
+// Eval feeds a sample of device id and returns the worst level held by the
+// rules, with their reasons. It is not safe for concurrent use.
+func (e *Engine) Eval(id string, cur *Sample) Verdict {
+	dev, ok := e.devices[id]
+	if !ok {
+		dev = &deviceState{rules: make([]ruleState, len(e.rules))}
+		e.devices[id] = dev
+	}
+
+	var ret Verdict
+	var reasons []string
+	for i, rule := range e.rules {
+		state := &dev.rules[i]
+		var v Verdict
+		if r, ok := rule.(DeviceRule); ok {
+			v = r.EvalDevice(id, dev.prev, cur)
+		} else {
+			v = rule.Eval(dev.prev, cur)
+		}
+		state.update(v, e.raise, e.clear)
+		if state.level == Healthy {
+			continue
+		}
+		if state.level > ret.Level {
+			ret.Level = state.level
+		}
+		reasons = append(reasons, rule.Name()+": "+state.reason)
+	}
+	dev.prev = cur
+	ret.Reason = strings.Join(reasons, "; ")
+	return ret
+}
+
+// Forget drops the history of a device that went away
+func (e *Engine) Forget(id string) {
+	delete(e.devices, id)
+	for _, rule := range e.rules {
+		if r, ok := rule.(DeviceRule); ok {
+			r.Forget(id)
+		}
+	}
+}
+
+func (s *ruleState) update(v Verdict, raise, clear int) {
+	if v.Level == s.level {
+		s.reason = v.Reason
+		s.count = 0
+		return
+	}
+	if v.Level != s.pending {
+		s.pending, s.count = v.Level, 0
+	}
+	s.count++
+
+	need := clear
+	if v.Level > s.level {
+		need = raise
+	}
+	if s.count >= need {
+		s.level, s.reason = v.Level, v.Reason
+		s.count = 0
+	}
+}
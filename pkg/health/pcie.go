@@ -0,0 +1,139 @@
+package health
+
+import (
+	"fmt"
+	"sort"
+	"strings"
+	"sync"
+
+	"gpu-device-plugin/pkg/erml"
+)
+
+// LinkStatus is what PcieRule knows about the PCIe link of a device
+type LinkStatus struct {
+	Baseline  erml.LinkInfo // link negotiated at discovery
+	Current   erml.LinkInfo
+	NakPerSec float64
+	// DownTrained is set when the link runs below its baseline or below
+	// what both ends are capable of
+	DownTrained bool
+}
+
+// PcieRule records the link every device negotiated when first seen and
+// degrades devices whose link trained down since, or never reached its
+// capability, or whose NAK rate exceeds NakPerSecond. Silently down-trained
+// slots cut host to device bandwidth by 2-4x without any other symptom.
+type PcieRule struct {
+	NakPerSecond float64
+
+	mu     sync.RWMutex
+	status map[string]LinkStatus
+}
+
+func NewPcieRule(nakPerSecond float64) *PcieRule {
+	return &PcieRule{NakPerSecond: nakPerSecond, status: make(map[string]LinkStatus)}
+}
+
+func (r *PcieRule) Name() string { return "pcie" }
+
+// Eval only checks the capability, the baseline needs the device id
+func (r *PcieRule) Eval(prev, cur *Sample) Verdict {
+	return r.EvalDevice("", prev, cur)
+}
+
+func (r *PcieRule) EvalDevice(id string, prev, cur *Sample) Verdict {
+	r.mu.Lock()
+	status, known := r.status[id]
+	if cur.Link != nil {
+		if !known {
+			status.Baseline = *cur.Link
+		}
+		status.Current = *cur.Link
+	}
+	status.NakPerSec = 0
+	if rate, ok := perMinute(prev, cur, func(s *Sample) (float64, bool) {
+		if s.Pcie == nil {
+			return 0, false
+		}
+		return float64(s.Pcie.Tx_Nak + s.Pcie.Rx_Nak), true
+	}); ok {
+		status.NakPerSec = rate / 60
+	}
+	var reasons []string
+	if cur.Link != nil {
+		reasons = linkReasons(status.Baseline, status.Current)
+	}
+	status.DownTrained = len(reasons) > 0
+	if id != "" && (known || cur.Link != nil) {
+		r.status[id] = status
+	}
+	r.mu.Unlock()
+
+	if status.NakPerSec > r.NakPerSecond {
+		reasons = append(reasons, fmt.Sprintf("%.1f naks/s", status.NakPerSec))
+	}
+	if len(reasons) == 0 {
+		return Verdict{}
+	}
+	return Verdict{Degraded, strings.Join(reasons, ", ")}
+}
+
+func linkReasons(baseline, cur erml.LinkInfo) []string {
+	var reasons []string
+	if cur.Link_Speed < baseline.Link_Speed || cur.Link_Width < baseline.Link_Width {
+		reasons = append(reasons, fmt.Sprintf("link trained down from %s to %s",
+			linkName(baseline.Link_Speed, baseline.Link_Width), linkName(cur.Link_Speed, cur.Link_Width)))
+	}
+	if cur.Max_Link_Speed > 0 && cur.Max_Link_Width > 0 &&
+		(cur.Link_Speed < cur.Max_Link_Speed || cur.Link_Width < cur.Max_Link_Width) {
+		reasons = append(reasons, fmt.Sprintf("link at %s, capable of %s",
+			linkName(cur.Link_Speed, cur.Link_Width), linkName(cur.Max_Link_Speed, cur.Max_Link_Width)))
+	}
+	return reasons
+}
+
+func linkName(speed, width uint) string {
+	return fmt.Sprintf("gen%d x%d", speed, width)
+}
+
+func (r *PcieRule) Forget(id string) {
+	r.mu.Lock()
+	delete(r.status, id)
+	r.mu.Unlock()
+}
+
+// Status returns the link status of a device
+func (r *PcieRule) Status(id string) (LinkStatus, bool) {
+	r.mu.RLock()
+	defer r.mu.RUnlock()
+	status, ok := r.status[id]
+	return status, ok
+}
+
+// NodeLabels suggests labels describing the PCIe links of the node, so
+// nodes with down-trained slots can be told apart in scheduling and
+// inventory
+func (r *PcieRule) NodeLabels() map[string]string {
+	r.mu.RLock()
+	defer r.mu.RUnlock()
+
+	var down []string
+	for id, status := range r.status {
+		if status.DownTrained {
+			down = append(down, id)
+		}
+	}
+	if len(down) == 0 {
+		return map[string]string{PcieDegradedLabel: "false"}
+	}
+	sort.Strings(down)
+	return map[string]string{
+		PcieDegradedLabel:        "true",
+		PcieDegradedDevicesLabel: strings.Join(down, "."),
+	}
+}
+
+const (
+	PcieDegradedLabel        = "jiangyuan.com/pcie-degraded"
+	PcieDegradedDevicesLabel = "jiangyuan.com/pcie-degraded-devices"
+)
@@ -0,0 +1,140 @@
+package health
+
+import (
+	"fmt"
+	"time"
+)
+
+// DefaultRules returns the rules used by the plugin, pcie is passed in so
+// the caller can read the link status it tracks
+func DefaultRules(pcie *PcieRule) []Rule {
+	return []Rule{
+		NewEccRule(10, 10*time.Minute),
+		&RmaRule{},
+		&ThermalRule{Degraded: 95, Unhealthy: 105},
+		pcie,
+	}
+}
+
+// EccRule fails a device on new double bit errors and degrades it on a
+// pending page retirement or a single bit error rate above SbePerMinute.
+// The DBE count is cumulative, so only its growth is graded. The failure
+// is held for DbeHold after the last new error. That gives the engine
+// samples enough to raise it, and lifts it from a card that recovered. A
+// card that does not recover is left to the RMA flag.
+type EccRule struct {
+	SbePerMinute float64
+	DbeHold      time.Duration
+
+	lastDbe map[string]dbeGrowth // device -> last DBE growth
+}
+
+type dbeGrowth struct {
+	at    time.Time
+	count uint
+}
+
+func NewEccRule(sbePerMinute float64, dbeHold time.Duration) *EccRule {
+	return &EccRule{SbePerMinute: sbePerMinute, DbeHold: dbeHold, lastDbe: make(map[string]dbeGrowth)}
+}
+
+func (r *EccRule) Name() string { return "ecc" }
+
+// Eval grades a device without history, see EvalDevice
+func (r *EccRule) Eval(prev, cur *Sample) Verdict {
+	return r.EvalDevice("", prev, cur)
+}
+
+func (r *EccRule) EvalDevice(id string, prev, cur *Sample) Verdict {
+	if cur.Ecc == nil || !cur.Ecc.Enabled {
+		return Verdict{}
+	}
+	if prev != nil && prev.Ecc != nil && cur.Ecc.Ecnt_db > prev.Ecc.Ecnt_db {
+		r.lastDbe[id] = dbeGrowth{at: cur.Time, count: cur.Ecc.Ecnt_db - prev.Ecc.Ecnt_db}
+	}
+	if last, ok := r.lastDbe[id]; ok {
+		if cur.Time.Sub(last.at) < r.DbeHold {
+			return Verdict{Unhealthy, fmt.Sprintf("%d new double bit errors at %s", last.count,
+				last.at.Format(time.RFC3339))}
+		}
+		delete(r.lastDbe, id)
+	}
+	if cur.Ecc.Pending || cur.Ecc.Pdblack {
+		return Verdict{Degraded, "page retirement pending"}
+	}
+	if rate, ok := perMinute(prev, cur, func(s *Sample) (float64, bool) {
+		if s.Ecc == nil {
+			return 0, false
+		}
+		return float64(s.Ecc.Ecnt_sb), true
+	}); ok && rate > r.SbePerMinute {
+		return Verdict{Degraded, fmt.Sprintf("%.1f single bit errors/min", rate)}
+	}
+	return Verdict{}
+}
+
+func (r *EccRule) Forget(id string) {
+	delete(r.lastDbe, id)
+}
+
+// RmaRule fails a device flagged for RMA and degrades it once the RMA
+// double bit error count grows
+type RmaRule struct{}
+
+func (r *RmaRule) Name() string { return "rma" }
+
+func (r *RmaRule) Eval(prev, cur *Sample) Verdict {
+	if cur.Rma == nil || !cur.Rma.SupportRma {
+		return Verdict{}
+	}
+	if cur.Rma.Flags {
+		return Verdict{Unhealthy, "flagged for rma"}
+	}
+	if prev != nil && prev.Rma != nil && cur.Rma.Dbe > prev.Rma.Dbe {
+		return Verdict{Degraded, fmt.Sprintf("%d double bit errors", cur.Rma.Dbe)}
+	}
+	return Verdict{}
+}
+
+// ThermalRule grades the ASIC temperature, in degrees Celsius
+type ThermalRule struct {
+	Degraded  float32
+	Unhealthy float32
+}
+
+func (r *ThermalRule) Name() string { return "thermal" }
+
+func (r *ThermalRule) Eval(_, cur *Sample) Verdict {
+	if cur.Thermal == nil {
+		return Verdict{}
+	}
+	temp := cur.Thermal.Cur_Asic_Temp
+	switch {
+	case temp >= r.Unhealthy:
+		return Verdict{Unhealthy, fmt.Sprintf("asic at %.0fC", temp)}
+	case temp >= r.Degraded:
+		return Verdict{Degraded, fmt.Sprintf("asic at %.0fC", temp)}
+	}
+	return Verdict{}
+}
+
+// perMinute returns the growth rate of a counter between two samples, a
+// counter going backwards (reset) yields no rate
+func perMinute(prev, cur *Sample, counter func(*Sample) (float64, bool)) (float64, bool) {
+	if prev == nil {
+		return 0, false
+	}
+	a, ok := counter(prev)
+	if !ok {
+		return 0, false
+	}
+	b, ok := counter(cur)
+	if !ok || b < a {
+		return 0, false
+	}
+	dt := cur.Time.Sub(prev.Time).Minutes()
+	if dt <= 0 {
+		return 0, false
+	}
+	return (b - a) / dt, true
+}
@@ -0,0 +1,382 @@
+package metrics
+
+import (
+	"context"
+	"net"
+	"net/http"
+	"strconv"
+	"sync"
+	"time"
+
+	"github.com/pkg/errors"
+	"k8s.io/klog/v2"
+
+	"gpu-device-plugin/pkg/erml"
+)
+
+const namespace = "jy_gpu_"
+
+// Exporter serves the latest sample in the Prometheus text format
+type Exporter struct {
+	sampler *Sampler
+	usage   *UsageSampler // nil when usage sampling is disabled
+	window  time.Duration // window of the usage statistics
+	gauges  []deviceGauge
+	labeled []labeledGauge
+	server  *http.Server
+}
+
+// DeviceGauges provides a per-device gauge computed outside the samplers
+type DeviceGauges interface {
+	DeviceCount() int
+	// DeviceGauge returns the value of a device, false leaves it out
+	DeviceGauge(dev_idx int) (float64, bool)
+}
+
+type deviceGauge struct {
+	family *family
+	source DeviceGauges
+}
+
+// LabeledGauges provides gauges keyed by labels other than the device,
+// e.g. per container
+type LabeledGauges interface {
+	// EachGauge calls fn for every series, labels are rendered without the
+	// braces, e.g. `pod_uid="x",device="1"`
+	EachGauge(fn func(labels string, v float64))
+}
+
+type labeledGauge struct {
+	family *family
+	source LabeledGauges
+}
+
+func NewExporter(addr string, sampler *Sampler, usage *UsageSampler, window time.Duration) *Exporter {
+	e := &Exporter{sampler: sampler, usage: usage, window: window}
+	mux := http.NewServeMux()
+	mux.Handle("/metrics", e)
+	e.server = &http.Server{Addr: addr, Handler: mux}
+	return e
+}
+
+// Register exports source as the gauge name, it must be called before Serve
+func (e *Exporter) Register(name, help string, source DeviceGauges) {
+	f := &family{name: name, help: help}
+	f.init()
+	e.gauges = append(e.gauges, deviceGauge{family: f, source: source})
+}
+
+// RegisterLabeled exports source as the gauge name, it must be called
+// before Serve
+func (e *Exporter) RegisterLabeled(name, help string, source LabeledGauges) {
+	f := &family{name: name, help: help}
+	f.init()
+	e.labeled = append(e.labeled, labeledGauge{family: f, source: source})
+}
+
+func (e *Exporter) Sampler() *Sampler {
+	return e.sampler
+}
+
+func (e *Exporter) UsageSampler() *UsageSampler {
+	return e.usage
+}
+
+// Serve listens on the configured address until Shutdown
+func (e *Exporter) Serve() error {
+	sock, err := net.Listen("tcp", e.server.Addr)
+	if err != nil {
+		return errors.WithMessagef(err, "listen %s failed", e.server.Addr)
+	}
+	klog.Infof("serving device metrics on %s/metrics", e.server.Addr)
+	if err := e.server.Serve(sock); err != http.ErrServerClosed {
+		return err
+	}
+	return nil
+}
+
+func (e *Exporter) Shutdown(ctx context.Context) error {
+	return e.server.Shutdown(ctx)
+}
+
+func (e *Exporter) ServeHTTP(w http.ResponseWriter, _ *http.Request) {
+	w.Header().Set("Content-Type", "text/plain; version=0.0.4; charset=utf-8")
+	enc := encoders.Get().(*encoder)
+	enc.writeSample(e.sampler.Latest())
+	if e.usage != nil {
+		enc.writeUsage(e.usage, e.window)
+	}
+	for _, g := range e.gauges {
+		enc.writeGauge(g.family, g.source)
+	}
+	for _, g := range e.labeled {
+		enc.writeLabeled(g.family, g.source)
+	}
+	if _, err := w.Write(enc.buf); err != nil {
+		klog.V(4).Infof("write metrics failed: %v", err)
+	}
+	enc.buf = enc.buf[:0]
+	encoders.Put(enc)
+}
+
+type family struct {
+	name, help string
+	write      func(e *encoder, f *family, d *erml.DevSnapshot)
+	field      erml.SnapshotMask
+
+	header string // HELP and TYPE lines
+	prefix string // metric name up to the device label value
+	open   string // metric name up to the opening brace
+}
+
+var families = []family{
+	{name: "dtu_usage_percent", help: "DTU usage of the device.", field: erml.SnapUsage,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, "", float64(d.Dtu_Usage))
+		}},
+	{name: "hbm_used", help: "HBM in use, as reported by erml.", field: erml.SnapMem,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, "", float64(d.Mem.Mem_Used))
+		}},
+	{name: "hbm_total", help: "HBM capacity, as reported by erml.", field: erml.SnapMem,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, "", float64(d.Mem.Mem_Total_Size))
+		}},
+	{name: "temperature_celsius", help: "Device temperature per sensor.", field: erml.SnapTemp,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, `,sensor="asic"`, float64(d.Thermal.Cur_Asic_Temp))
+			e.sample(f, d, `,sensor="mem"`, float64(d.Thermal.Cur_Mem_Temp))
+			e.sample(f, d, `,sensor="board"`, float64(d.Thermal.Cur_Board_Temp))
+		}},
+	{name: "power_watts", help: "Current power consumption.", field: erml.SnapPower,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, "", float64(d.Power.Cur_Pwr_Consumption))
+		}},
+	{name: "power_capability_watts", help: "Power capability of the device.", field: erml.SnapPower,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, "", float64(d.Power.Pwr_Capability))
+		}},
+	{name: "clock_mhz", help: "Current clock per domain.", field: erml.SnapClock,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, `,domain="dtu"`, float64(d.Clock.Cur_Dtu_Clock))
+			e.sample(f, d, `,domain="hbm"`, float64(d.Clock.Cur_Hbm_Clock))
+		}},
+	{name: "pcie_throughput", help: "PCIe throughput per direction.", field: erml.SnapPcie,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, `,direction="tx"`, float64(d.Pcie.Tx_Throughput))
+			e.sample(f, d, `,direction="rx"`, float64(d.Pcie.Rx_Throughput))
+		}},
+	{name: "pcie_nak", help: "PCIe NAK count per direction.", field: erml.SnapPcie,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, `,direction="tx"`, float64(d.Pcie.Tx_Nak))
+			e.sample(f, d, `,direction="rx"`, float64(d.Pcie.Rx_Nak))
+		}},
+	{name: "esl_throughput", help: "ESL throughput per port and direction.", field: erml.SnapEsl,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			for port, esl := range d.Esl {
+				e.indexed(f, d, `,port="`, port, `",direction="tx"`, float64(esl.Tx_Throughput))
+				e.indexed(f, d, `,port="`, port, `",direction="rx"`, float64(esl.Rx_Throughput))
+			}
+		}},
+	{name: "esl_nak", help: "ESL NAK count per port and direction.", field: erml.SnapEsl,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			for port, esl := range d.Esl {
+				e.indexed(f, d, `,port="`, port, `",direction="tx"`, float64(esl.Tx_Nak))
+				e.indexed(f, d, `,port="`, port, `",direction="rx"`, float64(esl.Rx_Nak))
+			}
+		}},
+	{name: "ecc_errors", help: "DRAM ECC error count per kind.", field: erml.SnapEcc,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, `,kind="single"`, float64(d.Ecc.Ecnt_sb))
+			e.sample(f, d, `,kind="double"`, float64(d.Ecc.Ecnt_db))
+		}},
+	{name: "healthy", help: "1 when erml reports the device healthy.", field: erml.SnapHealth,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			e.sample(f, d, "", bool2float(d.Health))
+		}},
+	{name: "cluster_usage_percent", help: "Usage per cluster.", field: erml.SnapClusters,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			for cluster, usage := range d.Cluster_Usage {
+				e.indexed(f, d, `,cluster="`, cluster, `"`, float64(usage))
+			}
+		}},
+	{name: "cluster_hbm_used", help: "HBM in use per cluster, as reported by erml.", field: erml.SnapClusters,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			for cluster, mem := range d.Cluster_Mem {
+				e.indexed(f, d, `,cluster="`, cluster, `"`, float64(mem.Mem_Used))
+			}
+		}},
+	{name: "cluster_hbm_total", help: "HBM capacity per cluster, as reported by erml.", field: erml.SnapClusters,
+		write: func(e *encoder, f *family, d *erml.DevSnapshot) {
+			for cluster, mem := range d.Cluster_Mem {
+				e.indexed(f, d, `,cluster="`, cluster, `"`, float64(mem.Mem_Total_Size))
+			}
+		}},
+}
+
+// vdevFamilies carry the usage of the virtual GCUs
+var vdevFamilies = []family{
+	{name: "vdev_dtu_usage_percent", help: "DTU usage of the virtual GCU."},
+	{name: "vdev_hbm_used", help: "HBM in use by the virtual GCU, as reported by erml."},
+	{name: "vdev_hbm_total", help: "HBM assigned to the virtual GCU, as reported by erml."},
+}
+
+// usageFamily carries the windowed statistics of the usage sampler
+var usageFamily = family{name: "dtu_usage_window_percent", help: "DTU usage statistics over the usage window."}
+
+// labelValues holds the rendered device, cluster and port numbers
+var labelValues [256]string
+
+func init() {
+	for i := range families {
+		families[i].init()
+	}
+	for i := range vdevFamilies {
+		vdevFamilies[i].init()
+	}
+	usageFamily.init()
+	for i := range labelValues {
+		labelValues[i] = strconv.Itoa(i)
+	}
+}
+
+func (f *family) init() {
+	f.header = "# HELP " + namespace + f.name + " " + f.help + "\n# TYPE " + namespace + f.name + " gauge\n"
+	f.prefix = namespace + f.name + `{device="`
+	f.open = namespace + f.name + "{"
+}
+
+// encoder renders the exposition text into a buffer reused across scrapes,
+// every label is either a constant or taken from labelValues so a scrape
+// does not format or allocate per sample once the buffer has grown
+type encoder struct {
+	buf []byte
+}
+
+var encoders = sync.Pool{New: func() any { return &encoder{buf: make([]byte, 0, 64<<10)} }}
+
+// writeSample renders every family as gauges, fields a device failed to
+// read are left out
+func (e *encoder) writeSample(sample *Sample) {
+	if sample == nil {
+		return
+	}
+	for i := range families {
+		f := &families[i]
+		e.buf = append(e.buf, f.header...)
+		for j := range sample.Devices {
+			dev := &sample.Devices[j]
+			if dev.Valid&f.field == 0 {
+				continue
+			}
+			f.write(e, f, dev)
+		}
+	}
+	e.writeVdevs(sample.Vdevs)
+}
+
+func (e *encoder) writeVdevs(vdevs []VdevSample) {
+	if len(vdevs) == 0 {
+		return
+	}
+	for i := range vdevFamilies {
+		f := &vdevFamilies[i]
+		e.buf = append(e.buf, f.header...)
+		for j := range vdevs {
+			vdev := &vdevs[j]
+			var v float64
+			switch i {
+			case 0:
+				v = float64(vdev.Usage)
+			case 1:
+				v = float64(vdev.Mem.Mem_Used)
+			case 2:
+				v = float64(vdev.Mem.Mem_Total_Size)
+			}
+			e.buf = append(e.buf, f.prefix...)
+			e.number(int(vdev.Dev_Idx))
+			e.buf = append(e.buf, `",vdev="`...)
+			e.number(int(vdev.Vdev_Idx))
+			e.buf = append(e.buf, '"')
+			e.value(v)
+		}
+	}
+}
+
+func (e *encoder) writeUsage(u *UsageSampler, window time.Duration) {
+	f := &usageFamily
+	e.buf = append(e.buf, f.header...)
+	for dev_idx := 0; dev_idx < u.DeviceCount(); dev_idx++ {
+		stats, ok := u.DeviceUsage(uint(dev_idx), window)
+		if !ok {
+			continue
+		}
+		e.device(f, dev_idx, `,stat="min"`, float64(stats.Min))
+		e.device(f, dev_idx, `,stat="avg"`, float64(stats.Avg))
+		e.device(f, dev_idx, `,stat="max"`, float64(stats.Max))
+		e.device(f, dev_idx, `,stat="p95"`, float64(stats.P95))
+	}
+}
+
+func (e *encoder) writeGauge(f *family, source DeviceGauges) {
+	e.buf = append(e.buf, f.header...)
+	for dev_idx := 0; dev_idx < source.DeviceCount(); dev_idx++ {
+		if v, ok := source.DeviceGauge(dev_idx); ok {
+			e.device(f, dev_idx, "", v)
+		}
+	}
+}
+
+func (e *encoder) writeLabeled(f *family, source LabeledGauges) {
+	e.buf = append(e.buf, f.header...)
+	source.EachGauge(func(labels string, v float64) {
+		e.buf = append(e.buf, f.open...)
+		e.buf = append(e.buf, labels...)
+		e.value(v)
+	})
+}
+
+func (e *encoder) sample(f *family, d *erml.DevSnapshot, labels string, v float64) {
+	e.device(f, int(d.Dev_Idx), labels, v)
+}
+
+func (e *encoder) device(f *family, dev_idx int, labels string, v float64) {
+	e.buf = append(e.buf, f.prefix...)
+	e.number(dev_idx)
+	e.buf = append(e.buf, '"')
+	e.buf = append(e.buf, labels...)
+	e.value(v)
+}
+
+// indexed writes a sample carrying a numbered label, key ends with the
+// opening quote of its value and labels starts with the closing one
+func (e *encoder) indexed(f *family, d *erml.DevSnapshot, key string, idx int, labels string, v float64) {
+	e.buf = append(e.buf, f.prefix...)
+	e.number(int(d.Dev_Idx))
+	e.buf = append(e.buf, '"')
+	e.buf = append(e.buf, key...)
+	e.number(idx)
+	e.buf = append(e.buf, labels...)
+	e.value(v)
+}
+
+func (e *encoder) number(i int) {
+	if i < len(labelValues) {
+		e.buf = append(e.buf, labelValues[i]...)
+		return
+	}
+	e.buf = strconv.AppendInt(e.buf, int64(i), 10)
+}
+
+func (e *encoder) value(v float64) {
+	e.buf = append(e.buf, "} "...)
+	e.buf = strconv.AppendFloat(e.buf, v, 'g', -1, 64)
+	e.buf = append(e.buf, '\n')
+}
+
+func bool2float(b bool) float64 {
+	if b {
+		return 1
+	}
+	return 0
+}
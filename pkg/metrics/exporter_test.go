@@ -0,0 +1,59 @@
+package metrics
+
+import (
+	"net/http"
+	"testing"
+	"time"
+
+	"gpu-device-plugin/pkg/erml"
+)
+
+// discard is a ResponseWriter that drops the body, so a scrape only counts
+// the allocations of the exporter
+type discard struct {
+	header http.Header
+	n      int
+}
+
+func (d *discard) Header() http.Header         { return d.header }
+func (d *discard) WriteHeader(int)             {}
+func (d *discard) Write(p []byte) (int, error) { d.n = len(p); return len(p), nil }
+
+// syntheticSample fills every field of devices cards with clusters clusters
+// and four ESL ports each
+func syntheticSample(devices, clusters int) *Sample {
+	sample := &Sample{Time: time.Now(), Devices: make([]erml.DevSnapshot, devices)}
+	for i := range sample.Devices {
+		d := &sample.Devices[i]
+		d.Dev_Idx = uint(i)
+		d.Valid = erml.SnapAll
+		d.Dtu_Usage = 42.5
+		d.Mem = erml.DevMemInfo{Mem_Total_Size: 64 << 30, Mem_Used: 12 << 30}
+		d.Health = true
+		d.Cluster_Usage = make([]float32, clusters)
+		d.Cluster_Mem = make([]erml.ClusterHbmMemInfo, clusters)
+		for c := range d.Cluster_Usage {
+			d.Cluster_Usage[c] = float32(c) + 0.5
+			d.Cluster_Mem[c] = erml.ClusterHbmMemInfo{Mem_Total_Size: 1 << 30, Mem_Used: uint(c) << 20}
+		}
+		d.Esl = make([]erml.ThroughputInfo, 4)
+	}
+	return sample
+}
+
+// BenchmarkScrape renders a node of 16 cards with 48 clusters each, a
+// scrape is expected to reuse its buffer and not allocate per sample
+func BenchmarkScrape(b *testing.B) {
+	e := NewExporter("", NewSampler(nil, time.Second, false), nil, 0)
+	e.sampler.latest.Store(syntheticSample(16, 48))
+	w := &discard{header: make(http.Header)}
+	req := &http.Request{}
+
+	e.ServeHTTP(w, req)
+	b.SetBytes(int64(w.n))
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		e.ServeHTTP(w, req)
+	}
+}
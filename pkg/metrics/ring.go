@@ -0,0 +1,67 @@
+package metrics
+
+import (
+	"math"
+	"slices"
+	"sync/atomic"
+)
+
+// ringSize is the number of samples kept per ring, at the default 1s usage
+// interval it covers a little over 8 minutes
+const ringSize = 512
+
+// ring is a fixed-size history of one usage series. It has a single writer
+// and any number of lock-free readers; a reader racing the writer may see
+// the oldest slot overwritten, which is harmless as long as windows stay
+// well below ringSize.
+type ring struct {
+	head  atomic.Uint64 // number of samples ever pushed
+	slots [ringSize]atomic.Uint32
+}
+
+func (r *ring) push(v float32) {
+	h := r.head.Load()
+	r.slots[h%ringSize].Store(math.Float32bits(v))
+	r.head.Store(h + 1)
+}
+
+// UsageStats summarizes the samples of a window
+type UsageStats struct {
+	Samples int
+	Min     float32
+	Avg     float32
+	Max     float32
+	P95     float32
+}
+
+// stats summarizes the last n samples
+func (r *ring) stats(n int) (UsageStats, bool) {
+	h := r.head.Load()
+	if n > ringSize {
+		n = ringSize
+	}
+	if uint64(n) > h {
+		n = int(h)
+	}
+	if n <= 0 {
+		return UsageStats{}, false
+	}
+
+	var buf [ringSize]float32
+	window := buf[:n]
+	var sum float64
+	for i := range window {
+		v := math.Float32frombits(r.slots[(h-uint64(n)+uint64(i))%ringSize].Load())
+		window[i] = v
+		sum += float64(v)
+	}
+	slices.Sort(window)
+
+	return UsageStats{
+		Samples: n,
+		Min:     window[0],
+		Avg:     float32(sum / float64(n)),
+		Max:     window[n-1],
+		P95:     window[(n*95+99)/100-1],
+	}, true
+}
@@ -0,0 +1,104 @@
+package metrics
+
+import (
+	"sync/atomic"
+	"time"
+
+	"k8s.io/klog/v2"
+
+	"gpu-device-plugin/pkg/erml"
+)
+
+// Sample is the telemetry of every device read in one sampling round, it is
+// never modified once published
+type Sample struct {
+	Time    time.Time
+	Devices []erml.DevSnapshot
+	Vdevs   []VdevSample // empty unless virtual GCUs are sampled
+}
+
+// VdevSample is the usage of one virtual GCU
+type VdevSample struct {
+	Dev_Idx  uint // parent card
+	Vdev_Idx uint
+	Usage    float32
+	Mem      erml.DevMemInfo
+}
+
+// Sampler reads the device telemetry on a fixed interval through the shared
+// erml session. Scrapes only read the latest sample, so the scrape rate and
+// the number of scrapers never reach the library.
+type Sampler struct {
+	session  *erml.Session
+	interval time.Duration
+	vdevs    bool
+	latest   atomic.Pointer[Sample]
+}
+
+// NewSampler samples every card, and every virtual GCU when vdevs is set
+func NewSampler(session *erml.Session, interval time.Duration, vdevs bool) *Sampler {
+	return &Sampler{session: session, interval: interval, vdevs: vdevs}
+}
+
+// Latest returns the last sample, nil before the first round completed
+func (s *Sampler) Latest() *Sample {
+	return s.latest.Load()
+}
+
+// Run samples until stop is closed
+func (s *Sampler) Run(stop <-chan struct{}) {
+	ticker := time.NewTicker(s.interval)
+	defer ticker.Stop()
+	for {
+		s.sample()
+		select {
+		case <-ticker.C:
+		case <-stop:
+			return
+		}
+	}
+}
+
+func (s *Sampler) sample() {
+	sample := &Sample{}
+	err := s.session.Do(func() (err error) {
+		sample.Devices, err = erml.SnapshotAll(erml.SnapAll, nil)
+		if err != nil || !s.vdevs {
+			return
+		}
+		sample.Vdevs, err = sampleVdevs(len(sample.Devices))
+		return
+	})
+	if err != nil {
+		klog.Warningf("sample device metrics failed: %v", err)
+		return
+	}
+	sample.Time = time.Now()
+	s.latest.Store(sample)
+}
+
+// sampleVdevs reads the usage of the virtual GCUs, a card without any is
+// skipped
+func sampleVdevs(cnt int) ([]VdevSample, error) {
+	var vdevs []VdevSample
+	var list []uint
+	for dev_idx := uint(0); dev_idx < uint(cnt); dev_idx++ {
+		handle := erml.DeviceByIndex(dev_idx)
+		var err error
+		list, err = handle.AppendVdevList(list[:0])
+		if erml.IsDriverError(err) {
+			return nil, err
+		}
+		for _, vdev_idx := range list {
+			vdev := VdevSample{Dev_Idx: dev_idx, Vdev_Idx: vdev_idx}
+			if usage, err := handle.GetVdevDtuUsage(vdev_idx); err == nil {
+				vdev.Usage = usage
+			}
+			if mem, err := handle.GetVdevDtuMem(vdev_idx); err == nil && mem != nil {
+				vdev.Mem = *mem
+			}
+			vdevs = append(vdevs, vdev)
+		}
+	}
+	return vdevs, nil
+}
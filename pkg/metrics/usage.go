@@ -0,0 +1,166 @@
+package metrics
+
+import (
+	"sync/atomic"
+	"time"
+
+	"github.com/pkg/errors"
+	"k8s.io/klog/v2"
+
+	"gpu-device-plugin/pkg/erml"
+)
+
+// UsageSampler polls the async usage APIs, which return the statistics of
+// the library's own sampling thread without touching the driver, into a
+// ring per device and per processing group. Readers summarize a window of
+// the rings and never call into erml.
+type UsageSampler struct {
+	session  *erml.Session
+	interval time.Duration
+	devices  atomic.Pointer[[]*deviceUsage]
+}
+
+type deviceUsage struct {
+	handle erml.Device
+	dtu    ring
+	pgs    []*ring
+}
+
+func NewUsageSampler(session *erml.Session, interval time.Duration) *UsageSampler {
+	return &UsageSampler{session: session, interval: interval}
+}
+
+func (u *UsageSampler) Interval() time.Duration {
+	return u.interval
+}
+
+// Run samples until stop is closed
+func (u *UsageSampler) Run(stop <-chan struct{}) {
+	ticker := time.NewTicker(u.interval)
+	defer ticker.Stop()
+	discovered := uint64(0)
+	for {
+		err := u.session.Do(func() error {
+			// device and PG counts are only re-read after a re-initialization
+			if inits := u.session.Inits(); inits != discovered {
+				if err := u.discover(); err != nil {
+					return err
+				}
+				discovered = inits
+			}
+			return u.sample()
+		})
+		if err != nil {
+			klog.Warningf("sample device usage failed: %v", err)
+		}
+
+		select {
+		case <-ticker.C:
+		case <-stop:
+			return
+		}
+	}
+}
+
+func (u *UsageSampler) discover() error {
+	cnt, err := erml.DeviceCount()
+	if err != nil {
+		return errors.WithMessage(err, "get dev count failed")
+	}
+
+	// keep the history of devices that are still there
+	var old []*deviceUsage
+	if p := u.devices.Load(); p != nil {
+		old = *p
+	}
+	devices := make([]*deviceUsage, cnt)
+	for dev_idx := uint(0); dev_idx < cnt; dev_idx++ {
+		handle := erml.DeviceByIndex(dev_idx)
+		pgCnt, err := handle.GetDevPGCount()
+		if err != nil {
+			pgCnt = 0
+		}
+		dev := &deviceUsage{handle: handle}
+		if int(dev_idx) < len(old) && len(old[dev_idx].pgs) == int(pgCnt) {
+			dev = old[dev_idx]
+		} else {
+			dev.pgs = make([]*ring, pgCnt)
+			for i := range dev.pgs {
+				dev.pgs[i] = &ring{}
+			}
+		}
+		devices[dev_idx] = dev
+	}
+	u.devices.Store(&devices)
+	return nil
+}
+
+// sample pushes one value per ring, a series that cannot be read this round
+// is skipped; only driver errors abort so the session gets re-initialized
+func (u *UsageSampler) sample() error {
+	for _, dev := range *u.devices.Load() {
+		usage, err := dev.handle.GetDevDtuUsageAsync()
+		if erml.IsDriverError(err) {
+			return errors.WithMessagef(err, "get dev [%d] usage failed", dev.handle.Index())
+		}
+		if err == nil {
+			dev.dtu.push(usage)
+		}
+		for pg_idx, pg := range dev.pgs {
+			usage, err := dev.handle.GetPGUsageAsync(uint(pg_idx))
+			if erml.IsDriverError(err) {
+				return errors.WithMessagef(err, "get dev [%d] pg [%d] usage failed", dev.handle.Index(), pg_idx)
+			}
+			if err == nil {
+				pg.push(usage)
+			}
+		}
+	}
+	return nil
+}
+
+// DeviceUsage summarizes the DTU usage of a device over the last window
+func (u *UsageSampler) DeviceUsage(dev_idx uint, window time.Duration) (UsageStats, bool) {
+	dev := u.device(dev_idx)
+	if dev == nil {
+		return UsageStats{}, false
+	}
+	return dev.dtu.stats(u.samples(window))
+}
+
+// PGUsage summarizes the usage of a processing group over the last window
+func (u *UsageSampler) PGUsage(dev_idx, pg_idx uint, window time.Duration) (UsageStats, bool) {
+	dev := u.device(dev_idx)
+	if dev == nil || pg_idx >= uint(len(dev.pgs)) {
+		return UsageStats{}, false
+	}
+	return dev.pgs[pg_idx].stats(u.samples(window))
+}
+
+// PGCount returns the number of processing groups sampled for a device
+func (u *UsageSampler) PGCount(dev_idx uint) int {
+	if dev := u.device(dev_idx); dev != nil {
+		return len(dev.pgs)
+	}
+	return 0
+}
+
+// DeviceCount returns the number of sampled devices
+func (u *UsageSampler) DeviceCount() int {
+	if p := u.devices.Load(); p != nil {
+		return len(*p)
+	}
+	return 0
+}
+
+func (u *UsageSampler) device(dev_idx uint) *deviceUsage {
+	p := u.devices.Load()
+	if p == nil || dev_idx >= uint(len(*p)) {
+		return nil
+	}
+	return (*p)[dev_idx]
+}
+
+func (u *UsageSampler) samples(window time.Duration) int {
+	return int(window / u.interval)
+}
@@ -0,0 +1,135 @@
+package plugin
+
+import (
+	"sort"
+	"strconv"
+	"sync/atomic"
+	"time"
+
+	"k8s.io/klog/v2"
+
+	"gpu-device-plugin/pkg/common"
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/metrics"
+	"gpu-device-plugin/pkg/process"
+)
+
+// Accountant charges the processes erml reports on every device to the
+// pod and container running them, for chargeback and right-sizing of the
+// device memory of every tenant. Processes outside of any pod are charged
+// to empty pod and container labels.
+type Accountant struct {
+	dm       *DeviceMonitor
+	interval time.Duration
+	resolver *process.Resolver
+	usage    atomic.Pointer[[]containerUsage] // ordered by labels
+	procs    []erml.ProcessInfo               // reused across samples
+	labels   map[usageKey]string              // rendered labels of the live containers
+}
+
+// containerUsage is the footprint of one container on one device
+type containerUsage struct {
+	labels    string // rendered pod_uid, container_id and device labels
+	mem       uint64 // device memory, bytes
+	processes int
+}
+
+type usageKey struct {
+	container process.Container
+	dev_idx   int
+}
+
+func NewAccountant(dm *DeviceMonitor, interval time.Duration, procRoot string) *Accountant {
+	return &Accountant{dm: dm, interval: interval, resolver: process.NewResolver(procRoot),
+		labels: make(map[usageKey]string)}
+}
+
+// Run samples until stop is closed
+func (a *Accountant) Run(stop <-chan struct{}) {
+	ticker := time.NewTicker(a.interval)
+	defer ticker.Stop()
+	for {
+		a.sample()
+		select {
+		case <-ticker.C:
+		case <-stop:
+			return
+		}
+	}
+}
+
+func (a *Accountant) sample() {
+	totals := make(map[usageKey]*containerUsage)
+	for _, device := range a.dm.Devices() {
+		dev_idx, err := strconv.Atoi(device.ID)
+		if err != nil {
+			continue
+		}
+		err = a.dm.session.Do(func() (err error) {
+			handle := erml.DeviceByIndex(uint(dev_idx))
+			a.procs, err = handle.AppendProcessInfo(a.procs[:0])
+			return
+		})
+		if err != nil {
+			if !isErmlCode(err, erml.ErrUnSupport) {
+				klog.Warningf("get dev [%d] process info failed: %v", dev_idx, err)
+			}
+			continue
+		}
+		for _, proc := range a.procs {
+			c, _ := a.resolver.Resolve(proc.Pid)
+			key := usageKey{container: c, dev_idx: dev_idx}
+			u, ok := totals[key]
+			if !ok {
+				labels, ok := a.labels[key]
+				if !ok {
+					labels = `pod_uid="` + c.PodUID + `",container_id="` + c.ContainerID + `",device="` + device.ID + `"`
+					a.labels[key] = labels
+				}
+				u = &containerUsage{labels: labels}
+				totals[key] = u
+			}
+			u.mem += proc.DevMemUsage * common.MemUnit
+			u.processes++
+		}
+	}
+	for key := range a.labels {
+		if _, ok := totals[key]; !ok {
+			delete(a.labels, key)
+		}
+	}
+	if dropped := a.resolver.Sweep(); dropped > 0 {
+		klog.V(4).Infof("forgot %d exited device processes", dropped)
+	}
+
+	usage := make([]containerUsage, 0, len(totals))
+	for _, u := range totals {
+		usage = append(usage, *u)
+	}
+	sort.Slice(usage, func(i, j int) bool { return usage[i].labels < usage[j].labels })
+	a.usage.Store(&usage)
+}
+
+// containerGauge exports one value of the footprint of every container
+type containerGauge struct {
+	a     *Accountant
+	value func(u *containerUsage) float64
+}
+
+func (g containerGauge) EachGauge(fn func(labels string, v float64)) {
+	usage := g.a.usage.Load()
+	if usage == nil {
+		return
+	}
+	for i := range *usage {
+		u := &(*usage)[i]
+		fn(u.labels, g.value(u))
+	}
+}
+
+func (a *Accountant) registerGauges(e *metrics.Exporter) {
+	e.RegisterLabeled("container_hbm_used_bytes", "Device memory used by the processes of the container.",
+		containerGauge{a, func(u *containerUsage) float64 { return float64(u.mem) }})
+	e.RegisterLabeled("container_processes", "Processes of the container running on the device.",
+		containerGauge{a, func(u *containerUsage) float64 { return float64(u.processes) }})
+}
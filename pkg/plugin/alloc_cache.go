@@ -0,0 +1,82 @@
+package plugin
+
+import (
+	"sync"
+
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+
+	"gpu-device-plugin/pkg/common"
+)
+
+// ctlSpec exposes the control node every container allocated a card needs
+var ctlSpec = &pluginapi.DeviceSpec{
+	HostPath:      common.HostPathPrefix + "gcuctl",
+	ContainerPath: common.ContainerPathPrefix + "gcuctl",
+	Permissions:   "rwm",
+}
+
+// allocCache keeps the container responses of the device sets allocated so
+// far, and the device specs they are built from. A response only depends
+// on its devices, so an entry never goes stale: it is shared by every later
+// Allocate of the same set and must not be modified. Past
+// common.AllocCacheSize sets an arbitrary entry makes room for the new one.
+type allocCache struct {
+	mu        sync.RWMutex
+	responses map[string]*pluginapi.ContainerAllocateResponse
+	specs     map[string]*pluginapi.DeviceSpec
+}
+
+func newAllocCache() *allocCache {
+	return &allocCache{
+		responses: make(map[string]*pluginapi.ContainerAllocateResponse),
+		specs:     make(map[string]*pluginapi.DeviceSpec),
+	}
+}
+
+// response returns the cached response of key, built by build on a miss
+func (a *allocCache) response(key string, build func() *pluginapi.ContainerAllocateResponse) *pluginapi.ContainerAllocateResponse {
+	a.mu.RLock()
+	resp, ok := a.responses[key]
+	a.mu.RUnlock()
+	if ok {
+		return resp
+	}
+	resp = build()
+
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	if cached, ok := a.responses[key]; ok {
+		return cached
+	}
+	if len(a.responses) >= common.AllocCacheSize {
+		for k := range a.responses {
+			delete(a.responses, k)
+			break
+		}
+	}
+	a.responses[key] = resp
+	return resp
+}
+
+// spec returns the shared device spec of a card
+func (a *allocCache) spec(id string) *pluginapi.DeviceSpec {
+	a.mu.RLock()
+	spec, ok := a.specs[id]
+	a.mu.RUnlock()
+	if ok {
+		return spec
+	}
+
+	spec = &pluginapi.DeviceSpec{
+		HostPath:      common.HostPathPrefix + common.DeviceName + id,
+		ContainerPath: common.ContainerPathPrefix + common.DeviceName + id,
+		Permissions:   "rwm",
+	}
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	if cached, ok := a.specs[id]; ok {
+		return cached
+	}
+	a.specs[id] = spec
+	return spec
+}
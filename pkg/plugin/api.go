@@ -1,10 +1,13 @@
 package plugin
 
 import (
+	"bytes"
 	"context"
 	"fmt"
 	"gpu-device-plugin/pkg/common"
+	"strconv"
 	"strings"
+	"time"
 
 	"github.com/pkg/errors"
 	"k8s.io/klog/v2"
@@ -15,28 +18,54 @@ import (
 // GetDevicePluginOptions returns options to be communicated with Device
 // Manager
 func (c *GpuDevicePlugin) GetDevicePluginOptions(_ context.Context, _ *pluginapi.Empty) (*pluginapi.DevicePluginOptions, error) {
-	return &pluginapi.DevicePluginOptions{PreStartRequired: true}, nil
+	return &pluginapi.DevicePluginOptions{PreStartRequired: true, GetPreferredAllocationAvailable: true}, nil
 }
 
 // ListAndWatch returns a stream of List of Devices
 // Whenever a Device state change or a Device disappears, ListAndWatch
 // returns the new list
 func (c *GpuDevicePlugin) ListAndWatch(_ *pluginapi.Empty, srv pluginapi.DevicePlugin_ListAndWatchServer) error {
-	devs := c.dm.Devices()
-	klog.Infof("find devices [%s]", String(devs))
+	var last, next []byte
+	for {
+		version, devs, changed := c.dm.store.Snapshot()
+		devs, virtChanged := c.virt.hide(devs)
+		if c.share != nil {
+			devs = c.share.expand(devs)
+		} else if c.mem != nil {
+			devs = c.mem.expand(devs)
+		}
 
-	err := srv.Send(&pluginapi.ListAndWatchResponse{Devices: devs})
-	if err != nil {
-		return errors.WithMessage(err, "send device failed")
-	}
+		// kubelet handles updates serially, skip lists it has already seen
+		next = renderDevices(next[:0], devs)
+		if last == nil || !bytes.Equal(next, last) {
+			klog.Infof("device list v%d [%s]", version, String(devs))
+			if err := srv.Send(&pluginapi.ListAndWatchResponse{Devices: devs}); err != nil {
+				return errors.WithMessage(err, "send device failed")
+			}
+			last, next = next, last
+		}
 
-	klog.Infoln("waiting for device update")
-	for range c.dm.notify {
-		devs = c.dm.Devices()
-		klog.Infof("device update,new device list [%s]", String(devs))
-		_ = srv.Send(&pluginapi.ListAndWatchResponse{Devices: devs})
+		select {
+		case <-changed:
+		case <-virtChanged:
+		case <-srv.Context().Done():
+			return nil
+		case <-c.stop:
+			return nil
+		}
+
+		// merge the rest of a burst, e.g. a reset of many cards, into one update
+		timer := time.NewTimer(c.opts.CoalesceWindow)
+		select {
+		case <-timer.C:
+		case <-srv.Context().Done():
+			timer.Stop()
+			return nil
+		case <-c.stop:
+			timer.Stop()
+			return nil
+		}
 	}
-	return nil
 }
 
 
@@ -45,47 +74,180 @@ func (c *GpuDevicePlugin) ListAndWatch(_ *pluginapi.Empty, srv pluginapi.DeviceP
 // guaranteed to be the allocation ultimately performed by the
 // devicemanager. It is only designed to help the devicemanager make a more
 // informed allocation decision when possible.
-func (c *GpuDevicePlugin) GetPreferredAllocation(_ context.Context, _ *pluginapi.PreferredAllocationRequest) (*pluginapi.PreferredAllocationResponse, error) {
-	return &pluginapi.PreferredAllocationResponse{}, nil
+func (c *GpuDevicePlugin) GetPreferredAllocation(_ context.Context, reqs *pluginapi.PreferredAllocationRequest) (*pluginapi.PreferredAllocationResponse, error) {
+	ret := &pluginapi.PreferredAllocationResponse{}
+	for _, req := range reqs.ContainerRequests {
+		var ids []string
+		if c.share != nil {
+			ids = c.preferReplicas(req)
+		} else if c.mem != nil {
+			c.mem.observeFree(c.dm.Devices(), req.AvailableDeviceIDs)
+			ids = c.mem.prefer(req.AvailableDeviceIDs, req.MustIncludeDeviceIDs, int(req.AllocationSize))
+		} else if c.topo != nil {
+			available := req.AvailableDeviceIDs
+			if req.AllocationSize > 1 {
+				available = c.healthyFirst(available, req.MustIncludeDeviceIDs, int(req.AllocationSize))
+			}
+			ids = c.topo.Select(available, req.MustIncludeDeviceIDs, int(req.AllocationSize))
+		}
+		if ids == nil {
+			// no topology, keep the devicemanager's own choice
+			ids = req.MustIncludeDeviceIDs
+		}
+		klog.Infof("[GetPreferredAllocation] size %d from [%s], prefer [%s]", req.AllocationSize,
+			strings.Join(req.AvailableDeviceIDs, ","), strings.Join(ids, ","))
+		ret.ContainerResponses = append(ret.ContainerResponses, &pluginapi.ContainerPreferredAllocationResponse{DeviceIDs: ids})
+	}
+	return ret, nil
 }
 
+// preferReplicas spreads a shared request over distinct cards, placed on the
+// topology, before stacking replicas on the least loaded ones
+func (c *GpuDevicePlugin) preferReplicas(req *pluginapi.ContainerPreferredAllocationRequest) []string {
+	c.share.observeFree(c.dm.Devices(), req.AvailableDeviceIDs)
+
+	var selectCards func(cards, must []string, size int) []string
+	if c.topo != nil {
+		selectCards = func(cards, must []string, size int) []string {
+			if size > 1 {
+				cards = c.healthyFirst(cards, must, size)
+			}
+			return c.topo.Select(cards, must, size)
+		}
+	}
+	return c.share.prefer(req.AvailableDeviceIDs, req.MustIncludeDeviceIDs, int(req.AllocationSize), selectCards)
+}
+
+// healthyFirst drops the degraded devices from a multi-card request unless
+// that leaves too few to satisfy it
+func (c *GpuDevicePlugin) healthyFirst(available, mustInclude []string, size int) []string {
+	healthy := make([]string, 0, len(available))
+	for _, id := range available {
+		if !c.dm.Degraded(id) || contains(mustInclude, id) {
+			healthy = append(healthy, id)
+		}
+	}
+	if len(healthy) < size {
+		return available
+	}
+	return healthy
+}
+
+func contains(ids []string, id string) bool {
+	for _, v := range ids {
+		if v == id {
+			return true
+		}
+	}
+	return false
+}
 
 // Allocate is called during container creation so that the Device
 // Plugin can run device specific operations and instruct Kubelet
 // of the steps to make the Device available in the container
 func (c *GpuDevicePlugin) Allocate(_ context.Context, reqs *pluginapi.AllocateRequest) (*pluginapi.AllocateResponse, error) {
-	ret := &pluginapi.AllocateResponse{}
+	ret := &pluginapi.AllocateResponse{
+		ContainerResponses: make([]*pluginapi.ContainerAllocateResponse, 0, len(reqs.ContainerRequests)),
+	}
+	var taken []string // replicas or slices, marked once the whole request is valid
 	for _, req := range reqs.ContainerRequests {
 		klog.Infof("[Allocate] received request: %v", strings.Join(req.DevicesIDs, ","))
-		
-		resp := pluginapi.ContainerAllocateResponse{}
-		
-		for _, id := range req.DevicesIDs {
+
+		ids := req.DevicesIDs
+		var slices []int // memory slices taken on every card
+		if c.share != nil || c.mem != nil {
+			var err error
+			if ids, slices, err = c.cards(ids); err != nil {
+				return nil, fmt.Errorf("invalid allocation request for '%s': %v", common.DeviceName, err)
+			}
+		}
+		for _, id := range ids {
 			if !c.dm.DeviceExist(id) {
 				return nil, fmt.Errorf("invalid allocation request for '%s': unknown device: %s", common.DeviceName, id)
 			}
-			d := pluginapi.DeviceSpec{}
+			if c.virt.has(id) {
+				return nil, fmt.Errorf("invalid allocation request for '%s': device %s is split into vgcus", common.DeviceName, id)
+			}
+		}
+		if c.share != nil || c.mem != nil {
+			taken = append(taken, req.DevicesIDs...)
+		}
+		ret.ContainerResponses = append(ret.ContainerResponses, c.containerResponse(ids, slices))
+	}
+	if c.share != nil {
+		c.share.markAllocated(taken)
+	} else if c.mem != nil {
+		c.mem.markAllocated(taken)
+	}
+	return ret, nil
+}
+
+// containerResponse returns the shared response allocating the cards ids,
+// slices holds the number of memory slices taken on every one of them
+func (c *GpuDevicePlugin) containerResponse(ids []string, slices []int) *pluginapi.ContainerAllocateResponse {
+	joined := strings.Join(ids, ",")
+	key := joined
+	if c.mem != nil {
+		key += "/"
+		for i, n := range slices {
+			if i > 0 {
+				key += ","
+			}
+			key += strconv.Itoa(n)
+		}
+	}
+	return c.allocs.response(key, func() *pluginapi.ContainerAllocateResponse {
+		resp := &pluginapi.ContainerAllocateResponse{
+			Devices: make([]*pluginapi.DeviceSpec, 0, len(ids)+1),
+			Envs:    map[string]string{c.res.env: joined},
+		}
+		for _, id := range ids {
 			// Expose the device node for pod.
-			d.HostPath = common.HostPathPrefix + common.DeviceName + id
-			d.ContainerPath = common.ContainerPathPrefix + common.DeviceName + id
-			d.Permissions = "rwm"
-			resp.Devices = append(resp.Devices, &d)
+			resp.Devices = append(resp.Devices, c.allocs.spec(id))
+		}
+		resp.Devices = append(resp.Devices, ctlSpec)
+		if c.mem != nil {
+			resp.Envs[common.MemLimitEnvName] = c.mem.limits(ids, slices)
 		}
+		return resp
+	})
+}
 
-		d := pluginapi.DeviceSpec{}
-		// Expose the device node for pod.
-		d.HostPath = common.HostPathPrefix + "gcuctl"
-		d.ContainerPath = common.ContainerPathPrefix + "gcuctl"
-		d.Permissions = "rwm"
-		resp.Devices = append(resp.Devices, &d)
+// warmAllocs builds the responses of the single cards at discovery, the
+// multi-card sets are built by their first Allocate
+func (c *GpuDevicePlugin) warmAllocs() {
+	for _, device := range c.dm.Devices() {
+		c.containerResponse([]string{device.ID}, []int{1})
+	}
+}
 
-		resp.Envs = map[string]string{
-			common.EnvName: strings.Join(req.DevicesIDs, ","),
+// cards maps shared replica or memory slice IDs to their distinct cards,
+// counts holds how many of the IDs fall on every card
+func (c *GpuDevicePlugin) cards(replicas []string) (ids []string, counts []int, err error) {
+	var toCard func(string) (string, error)
+	if c.share != nil {
+		toCard = c.share.card
+	} else {
+		toCard = c.mem.card
+	}
+	ids = make([]string, 0, len(replicas))
+	counts = make([]int, 0, len(replicas))
+	for _, replica := range replicas {
+		card, err := toCard(replica)
+		if err != nil {
+			return nil, nil, err
 		}
-		
-		ret.ContainerResponses = append(ret.ContainerResponses, &resp)
+		i := 0
+		for i < len(ids) && ids[i] != card {
+			i++
+		}
+		if i == len(ids) {
+			ids = append(ids, card)
+			counts = append(counts, 0)
+		}
+		counts[i]++
 	}
-	return ret, nil
+	return ids, counts, nil
 }
 
 // PreStartContainer is called, if indicated by Device Plugin during registeration phase,
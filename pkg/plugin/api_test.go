@@ -0,0 +1,60 @@
+package plugin
+
+import (
+	"context"
+	"fmt"
+	"strconv"
+	"testing"
+
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+)
+
+// testPlugin serves n healthy cards without erml, the monitor only holds
+// the devices of a scan
+func testPlugin(n int) *GpuDevicePlugin {
+	devices := make([]*pluginapi.Device, n)
+	for i := range devices {
+		devices[i] = &pluginapi.Device{ID: strconv.Itoa(i), Health: pluginapi.Healthy}
+	}
+	dm := NewDeviceMonitor("", nil, func() ([]*pluginapi.Device, error) { return devices, nil })
+	dm.store.Replace(devices)
+	return &GpuDevicePlugin{res: gcuResource, dm: dm, allocs: newAllocCache()}
+}
+
+func allocateRequest(size int) *pluginapi.AllocateRequest {
+	ids := make([]string, size)
+	for i := range ids {
+		ids[i] = strconv.Itoa(i)
+	}
+	return &pluginapi.AllocateRequest{
+		ContainerRequests: []*pluginapi.ContainerAllocateRequest{{DevicesIDs: ids}},
+	}
+}
+
+// BenchmarkAllocate times a container of size cards, cached answers from
+// the responses of the earlier calls while uncached starts every call with
+// an empty cache
+func BenchmarkAllocate(b *testing.B) {
+	for _, size := range []int{1, 8, 16} {
+		req := allocateRequest(size)
+		b.Run(fmt.Sprintf("devices=%d/cached", size), func(b *testing.B) {
+			c := testPlugin(16)
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if _, err := c.Allocate(context.Background(), req); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+		b.Run(fmt.Sprintf("devices=%d/uncached", size), func(b *testing.B) {
+			c := testPlugin(16)
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				c.allocs = newAllocCache()
+				if _, err := c.Allocate(context.Background(), req); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
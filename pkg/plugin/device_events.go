@@ -0,0 +1,114 @@
+package plugin
+
+import (
+	"fmt"
+	"time"
+
+	"github.com/pkg/errors"
+	"k8s.io/klog/v2"
+
+	"gpu-device-plugin/pkg/common"
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/health"
+)
+
+// WatchEvents subscribes to the upstream events of every device and turns
+// them into health transitions, so a suspended or resetting card is
+// withdrawn from kubelet right away instead of at the next rescan.
+func (d *DeviceMonitor) WatchEvents() error {
+	klog.Infoln("watching device events")
+
+	timeout := int(common.EventWaitTimeout / time.Millisecond)
+	subscribed := uint64(0)
+	for {
+		var event *erml.EventInfo
+		err := d.session.Do(func() error {
+			// a re-initialized library forgets the subscriptions
+			if inits := d.session.Inits(); inits != subscribed {
+				if err := subscribe(); err != nil {
+					return err
+				}
+				subscribed = inits
+			}
+
+			// short waits in a loop, a long one inside Do would hold off a
+			// re-initialization and every caller queued behind it
+			var err error
+			event, err = erml.WaitEvent(timeout)
+			return err
+		})
+
+		switch {
+		case err == nil:
+			d.handleEvent(event)
+		case isErmlCode(err, erml.ErrTimeout):
+		case isErmlCode(err, erml.ErrUnSupport):
+			klog.Warningf("device events not supported, relying on rescan every %v", common.ReconcileInterval)
+			return nil
+		case erml.IsDriverError(err):
+			klog.Warningf("wait device event failed, re-subscribing: %v", err)
+			time.Sleep(common.EventPollTimeout)
+		default:
+			return errors.WithMessage(err, "wait device event failed")
+		}
+	}
+}
+
+func subscribe() error {
+	cnt, err := erml.DeviceCount()
+	if err != nil {
+		return errors.WithMessage(err, "get dev count failed")
+	}
+	for dev_idx := uint(0); dev_idx < cnt; dev_idx++ {
+		handle := erml.DeviceByIndex(dev_idx)
+		if err = handle.StartListenEvent(); err != nil {
+			return errors.WithMessagef(err, "listen dev [%d] event failed", dev_idx)
+		}
+	}
+	return nil
+}
+
+// handleEvent maps an erml event to the health of the device it was raised
+// for, the event id carries the device index.
+func (d *DeviceMonitor) handleEvent(event *erml.EventInfo) {
+	id := fmt.Sprintf("%d", event.Id)
+	klog.Infof("device [%s] event %d: %s", id, event.Type, event.Msg)
+
+	switch event.Type {
+	case erml.EventResetStart:
+		erml.InvalidateDevice(event.Id)
+		d.Report(id, sourceErml, health.Verdict{Level: health.Unhealthy, Reason: "reset in progress"})
+	case erml.EventDtuSuspend:
+		d.Report(id, sourceErml, health.Verdict{Level: health.Unhealthy, Reason: "dtu suspended"})
+	case erml.EventResetFinish:
+		erml.InvalidateDevice(event.Id)
+		healthy, err := d.deviceHealth(event.Id)
+		if err != nil {
+			klog.Errorf("get dev [%s] health after reset failed: %v", id, err)
+			return
+		}
+		d.Report(id, sourceErml, ermlVerdict(healthy))
+	}
+}
+
+func (d *DeviceMonitor) deviceHealth(dev_idx uint) (bool, error) {
+	var healthy bool
+	err := d.session.Do(func() (err error) {
+		handle := erml.DeviceByIndex(dev_idx)
+		healthy, err = handle.GetDevIsHealth()
+		return
+	})
+	return healthy, err
+}
+
+func ermlVerdict(healthy bool) health.Verdict {
+	if healthy {
+		return health.Verdict{}
+	}
+	return health.Verdict{Level: health.Unhealthy, Reason: "reported unhealthy"}
+}
+
+func isErmlCode(err error, code erml.ErmlError) bool {
+	var e erml.ErmlError
+	return errors.As(err, &e) && e.ErrCode == code.ErrCode
+}
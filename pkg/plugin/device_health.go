@@ -0,0 +1,259 @@
+package plugin
+
+import (
+	"fmt"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"k8s.io/klog/v2"
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/health"
+	"gpu-device-plugin/pkg/metrics"
+)
+
+// health sources, each one reports its own verdict per device
+const (
+	sourceErml      = "erml"      // GetDevIsHealth and reset/suspend events
+	sourceHeartbeat = "heartbeat" // firmware heartbeat watchdog
+	sourceRules     = "rules"     // health rule engine
+	sourceParent    = "parent"    // parent card of a virtual GCU
+)
+
+// healthBoard combines the verdicts of every source, a device takes the
+// worst of them. Kubelet only sees Unhealthy versus the rest, Degraded
+// devices are tracked for the placement.
+type healthBoard struct {
+	mu       sync.Mutex
+	reports  map[string]map[string]health.Verdict // device -> source -> verdict
+	degraded atomic.Pointer[map[string]struct{}]
+}
+
+func newHealthBoard() *healthBoard {
+	b := &healthBoard{reports: make(map[string]map[string]health.Verdict)}
+	b.degraded.Store(&map[string]struct{}{})
+	return b
+}
+
+// set records a verdict and returns the combined one
+func (b *healthBoard) set(id, source string, v health.Verdict) health.Verdict {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+
+	sources, ok := b.reports[id]
+	if !ok {
+		sources = make(map[string]health.Verdict)
+		b.reports[id] = sources
+	}
+	sources[source] = v
+	ret := combine(sources)
+	b.setDegradedLocked(id, ret.Level == health.Degraded)
+	return ret
+}
+
+// get returns the combined verdict of a device
+func (b *healthBoard) get(id string) health.Verdict {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	return combine(b.reports[id])
+}
+
+func (b *healthBoard) setDegradedLocked(id string, degraded bool) {
+	cur := *b.degraded.Load()
+	if _, ok := cur[id]; ok == degraded {
+		return
+	}
+	next := make(map[string]struct{}, len(cur)+1)
+	for k := range cur {
+		next[k] = struct{}{}
+	}
+	if degraded {
+		next[id] = struct{}{}
+	} else {
+		delete(next, id)
+	}
+	b.degraded.Store(&next)
+}
+
+func (b *healthBoard) isDegraded(id string) bool {
+	_, ok := (*b.degraded.Load())[id]
+	return ok
+}
+
+func combine(sources map[string]health.Verdict) health.Verdict {
+	var ret health.Verdict
+	var reasons []string
+	for source, v := range sources {
+		if v.Level == health.Healthy {
+			continue
+		}
+		if v.Level > ret.Level {
+			ret.Level = v.Level
+		}
+		reasons = append(reasons, source+" ("+v.Reason+")")
+	}
+	ret.Reason = strings.Join(reasons, ", ")
+	return ret
+}
+
+func kubeletHealth(l health.Level) string {
+	if l == health.Unhealthy {
+		return pluginapi.Unhealthy
+	}
+	return pluginapi.Healthy
+}
+
+// Report records the verdict of a health source for a device and updates
+// what kubelet sees, it returns whether the kubelet visible health changed
+func (d *DeviceMonitor) Report(id, source string, v health.Verdict) bool {
+	combined := d.health.set(id, source, v)
+	changed := d.store.SetHealth(id, kubeletHealth(combined.Level))
+	if changed {
+		if combined.Level == health.Unhealthy {
+			klog.Warningf("device [%s] is not healthy: %s", id, combined.Reason)
+		} else {
+			klog.Infof("device [%s] is %s again", id, combined.Level)
+		}
+	}
+	return changed
+}
+
+// Degraded reports whether a device should be kept out of multi-card
+// placements
+func (d *DeviceMonitor) Degraded(id string) bool {
+	return d.health.isDegraded(id)
+}
+
+// HealthMonitor samples the health telemetry of every device and feeds it
+// to the rule engine
+type HealthMonitor struct {
+	dm       *DeviceMonitor
+	interval time.Duration
+	pcie     *health.PcieRule // also registered in engine
+	engine   *health.Engine
+	labels   string // last suggested node labels
+}
+
+func NewHealthMonitor(dm *DeviceMonitor, interval time.Duration, pcie *health.PcieRule, engine *health.Engine) *HealthMonitor {
+	return &HealthMonitor{dm: dm, interval: interval, pcie: pcie, engine: engine}
+}
+
+// Run evaluates until stop is closed
+func (m *HealthMonitor) Run(stop <-chan struct{}) {
+	ticker := time.NewTicker(m.interval)
+	defer ticker.Stop()
+	for {
+		for _, device := range m.dm.Devices() {
+			sample, err := m.sample(device.ID)
+			if err != nil {
+				klog.Warningf("sample dev [%s] health failed: %v", device.ID, err)
+				continue
+			}
+			m.dm.Report(device.ID, sourceRules, m.engine.Eval(device.ID, sample))
+		}
+		m.suggestLabels()
+		select {
+		case <-ticker.C:
+		case <-stop:
+			return
+		}
+	}
+}
+
+// sample reads every signal it can, a signal the device does not support
+// is left nil
+func (m *HealthMonitor) sample(id string) (*health.Sample, error) {
+	var dev_idx uint
+	if _, err := fmt.Sscanf(id, "%d", &dev_idx); err != nil {
+		return nil, err
+	}
+	sample := &health.Sample{}
+	err := m.dm.session.Do(func() error {
+		handle := erml.DeviceByIndex(dev_idx)
+		sample.Time = time.Now()
+		if ecc, err := handle.GetDevEccStatus(); err == nil {
+			sample.Ecc = ecc
+		} else if erml.IsDriverError(err) {
+			return err
+		}
+		if rma, err := handle.GetDevRmaDetails(); err == nil {
+			sample.Rma = rma
+		}
+		if thermal, err := handle.GetDevTempV2(); err == nil {
+			sample.Thermal = thermal
+		}
+		if link, err := handle.GetPcieLinkInfo(); err == nil {
+			sample.Link = link
+		}
+		if pcie, err := handle.GetPcieThroughput(); err == nil {
+			sample.Pcie = pcie
+		}
+		return nil
+	})
+	return sample, err
+}
+
+// suggestLabels logs the node labels describing the PCIe links whenever
+// they change, the plugin has no access to the node object itself
+func (m *HealthMonitor) suggestLabels() {
+	labels := m.pcie.NodeLabels()
+	keys := make([]string, 0, len(labels))
+	for k := range labels {
+		keys = append(keys, k)
+	}
+	sort.Strings(keys)
+	pairs := make([]string, 0, len(keys))
+	for _, k := range keys {
+		pairs = append(pairs, k+"="+labels[k])
+	}
+	if s := strings.Join(pairs, ","); s != m.labels {
+		m.labels = s
+		klog.Infof("suggested node labels: %s", s)
+	}
+}
+
+// pcieGauge exports one value of the link status of every device
+type pcieGauge struct {
+	dm    *DeviceMonitor
+	rule  *health.PcieRule
+	value func(health.LinkStatus) float64
+}
+
+func (g pcieGauge) DeviceCount() int {
+	return len(g.dm.Devices())
+}
+
+func (g pcieGauge) DeviceGauge(dev_idx int) (float64, bool) {
+	status, ok := g.rule.Status(strconv.Itoa(dev_idx))
+	if !ok {
+		return 0, false
+	}
+	return g.value(status), true
+}
+
+func (m *HealthMonitor) registerPcieGauges(e *metrics.Exporter) {
+	e.Register("pcie_link_speed", "Negotiated PCIe generation.", pcieGauge{m.dm, m.pcie,
+		func(s health.LinkStatus) float64 { return float64(s.Current.Link_Speed) }})
+	e.Register("pcie_link_width", "Negotiated PCIe lanes.", pcieGauge{m.dm, m.pcie,
+		func(s health.LinkStatus) float64 { return float64(s.Current.Link_Width) }})
+	e.Register("pcie_link_baseline_speed", "PCIe generation negotiated at discovery.", pcieGauge{m.dm, m.pcie,
+		func(s health.LinkStatus) float64 { return float64(s.Baseline.Link_Speed) }})
+	e.Register("pcie_link_baseline_width", "PCIe lanes negotiated at discovery.", pcieGauge{m.dm, m.pcie,
+		func(s health.LinkStatus) float64 { return float64(s.Baseline.Link_Width) }})
+	e.Register("pcie_link_downtrained", "1 when the PCIe link runs below its baseline or capability.", pcieGauge{m.dm, m.pcie,
+		func(s health.LinkStatus) float64 { return bool2float(s.DownTrained) }})
+	e.Register("pcie_nak_per_second", "PCIe NAK rate, both directions.", pcieGauge{m.dm, m.pcie,
+		func(s health.LinkStatus) float64 { return s.NakPerSec }})
+}
+
+func bool2float(b bool) float64 {
+	if b {
+		return 1
+	}
+	return 0
+}
@@ -8,6 +8,7 @@ import (
 	"github.com/pkg/errors"
 	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
 
+	"gpu-device-plugin/pkg/common"
 	"gpu-device-plugin/pkg/erml"
 
 	"k8s.io/klog/v2"
@@ -15,46 +16,61 @@ import (
 
 type DeviceMonitor struct {
 	path    string
-	devices map[string]*pluginapi.Device
-	notify  chan struct{} // notify when device update
+	scan    func() ([]*pluginapi.Device, error)
+	session *erml.Session // shared erml session, kept open across scans
+	store   *deviceStore  // versioned devices, watched by ListAndWatch
+	health  *healthBoard  // verdicts of every health source
 }
 
-func NewDeviceMonitor(path string) *DeviceMonitor {
+func NewDeviceMonitor(path string, session *erml.Session, scan func() ([]*pluginapi.Device, error)) *DeviceMonitor {
 	return &DeviceMonitor{
 		path:    path,
-		devices: make(map[string]*pluginapi.Device),
-		notify:  make(chan struct{}),
+		scan:    scan,
+		session: session,
+		store:   newDeviceStore(),
+		health:  newHealthBoard(),
 	}
 }
 
 func (d *DeviceMonitor) List() error {
 	klog.Infoln("watching devices")
 
-	devices, err := list()
+	devices, err := d.list()
 	if err != nil {
 		return err
 	}
 
-	for _, device := range devices {
-		device_name := device.ID
-		d.devices[device_name] = device
-	}
-
+	d.store.Replace(devices)
 	return nil
 }
 
+// list scans the devices through the shared session, the library is only
+// re-initialized when the scan hits a driver level error. The health erml
+// reports is combined with the other health sources.
+func (d *DeviceMonitor) list() (devices []*pluginapi.Device, err error) {
+	err = d.session.Do(func() error {
+		devices, err = d.scan()
+		return err
+	})
+	for _, device := range devices {
+		combined := d.health.set(device.ID, sourceErml, ermlVerdict(device.Health == pluginapi.Healthy))
+		device.Health = kubeletHealth(combined.Level)
+	}
+	return
+}
 
-func list() ([]*pluginapi.Device, error){
+func scan() ([]*pluginapi.Device, error){
 	devices := make([]*pluginapi.Device, 0)
-	erml.InitV2(false)
-	defer erml.Shutdown()
-	
-	cnt, err := erml.GetDevCount()
+
+	cnt, err := erml.DeviceCount()
 	if err!= nil {
 		return nil, errors.WithMessage(err, "get dev count failed")
 	}
 	for dev_idx := uint(0); dev_idx < cnt; dev_idx++ {
-		handle, _ := erml.GetDeviceHandleByIndex(dev_idx)
+		handle := erml.DeviceByIndex(dev_idx)
+		if err := handle.Resolve(); err != nil {
+			klog.Warningf("resolve dev [%d] sysfs path failed: %v", dev_idx, err)
+		}
 		var devInfo *erml.DeviceInfo
 		devInfo, err = handle.GetDevInfo()
 		
@@ -96,25 +112,21 @@ func (d *DeviceMonitor) Watch() error {
 			}
 		}()
 		for {
-			time.Sleep(time.Minute)
-			newDevices, err := list()
+			time.Sleep(common.ReconcileInterval)
+			newDevices, err := d.list()
 			if err != nil {
-				errChan <- err
-				return
+				// the session re-initializes on the next call, retry then
+				klog.Errorf("rescan devices failed, retrying in %v: %v", common.ReconcileInterval, err)
+				continue
 			}
 
-			updated := false
-			for _, newDevice := range newDevices {
-				oldDevice, exists := d.devices[newDevice.ID]
-				if !exists || oldDevice.Health != newDevice.Health {
-					d.devices[newDevice.ID] = newDevice
-					updated = true
+			if diff := d.store.Replace(newDevices); !diff.Empty() {
+				klog.Infof("device update, %s", diff)
+				if len(diff.Added) > 0 || len(diff.Removed) > 0 {
+					// hot-plug, indexes may point at other cards now
+					erml.InvalidateDevices()
 				}
 			}
-
-			if updated {
-				d.notify <- struct{}{}
-			}
 		}
 	}()
 
@@ -123,16 +135,13 @@ func (d *DeviceMonitor) Watch() error {
 }
 
 func (d *DeviceMonitor) DeviceExist(id string) bool {
-	_, ok := d.devices[id]
+	_, ok := d.store.Get(id)
 	return ok
 }
 
-// Devices transformer map to slice
+// Devices returns the devices ordered by ID
 func (d *DeviceMonitor) Devices() []*pluginapi.Device {
-	devices := make([]*pluginapi.Device, 0, len(d.devices))
-	for _, device := range d.devices {
-		devices = append(devices, device)
-	}
+	_, devices, _ := d.store.Snapshot()
 	return devices
 }
 
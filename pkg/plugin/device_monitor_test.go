@@ -0,0 +1,57 @@
+package plugin
+
+import (
+	"io"
+	"os"
+	"testing"
+
+	"k8s.io/klog/v2"
+
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/erml/sim"
+)
+
+// TestMain runs the package against a simulated node of 16 cards, none of
+// the tests reach liberml. The logs of every Allocate would break the lines
+// of the benchmark results.
+func TestMain(m *testing.M) {
+	klog.LogToStderr(false)
+	klog.SetOutput(io.Discard)
+	erml.SetBackend(sim.New(&sim.Scenario{
+		Devices: []sim.DeviceSpec{{Count: 16, Clusters: 4, HbmMiB: 65536, EslPorts: 2}},
+		Manual:  true,
+	}))
+	os.Exit(m.Run())
+}
+
+func BenchmarkList(b *testing.B) {
+	session, err := erml.OpenSession(false)
+	if err != nil {
+		b.Fatal(err)
+	}
+	defer session.Close()
+	dm := NewDeviceMonitor("", session, scan)
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		if _, err := dm.list(); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+func BenchmarkDevices(b *testing.B) {
+	dm := testPlugin(16).dm
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		dm.Devices()
+	}
+}
+
+func BenchmarkString(b *testing.B) {
+	devices := testPlugin(16).dm.Devices()
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		String(devices)
+	}
+}
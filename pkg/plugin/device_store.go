@@ -0,0 +1,159 @@
+package plugin
+
+import (
+	"sort"
+	"strings"
+	"sync"
+	"sync/atomic"
+
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+)
+
+// deviceDiff describes what a store update changed
+type deviceDiff struct {
+	Added   []string
+	Removed []string
+	Health  []string // devices whose health flipped
+}
+
+func (d deviceDiff) Empty() bool {
+	return len(d.Added) == 0 && len(d.Removed) == 0 && len(d.Health) == 0
+}
+
+func (d deviceDiff) String() string {
+	return "added [" + strings.Join(d.Added, ",") + "] removed [" + strings.Join(d.Removed, ",") +
+		"] health changed [" + strings.Join(d.Health, ",") + "]"
+}
+
+// deviceStore is the versioned set of devices advertised to kubelet. The
+// devices are published as immutable snapshots through an atomic pointer:
+// readers (Allocate, ListAndWatch) never take a lock, writers copy the
+// snapshot, apply their change and swap it in. Every effective change bumps
+// the version and wakes the watchers up.
+type deviceStore struct {
+	mu      sync.Mutex // serializes writers
+	current atomic.Pointer[deviceSnapshot]
+}
+
+// deviceSnapshot is never modified once published
+type deviceSnapshot struct {
+	version uint64
+	devices map[string]*pluginapi.Device
+	sorted  []*pluginapi.Device // devices ordered by ID
+	changed chan struct{}       // closed when the next snapshot is published
+}
+
+func newDeviceStore() *deviceStore {
+	s := &deviceStore{}
+	s.current.Store(&deviceSnapshot{
+		devices: make(map[string]*pluginapi.Device),
+		changed: make(chan struct{}),
+	})
+	return s
+}
+
+// Replace installs the result of a full scan, devices missing from it are
+// removed.
+func (s *deviceStore) Replace(devices []*pluginapi.Device) deviceDiff {
+	var diff deviceDiff
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	cur := s.current.Load()
+	next := make(map[string]*pluginapi.Device, len(devices))
+	for _, device := range devices {
+		next[device.ID] = device
+		old, ok := cur.devices[device.ID]
+		switch {
+		case !ok:
+			diff.Added = append(diff.Added, device.ID)
+		case old.Health != device.Health:
+			diff.Health = append(diff.Health, device.ID)
+		default:
+			// keep the published device, it is what kubelet has seen
+			next[device.ID] = old
+		}
+	}
+	for id := range cur.devices {
+		if _, ok := next[id]; !ok {
+			diff.Removed = append(diff.Removed, id)
+		}
+	}
+	sort.Strings(diff.Removed)
+
+	if !diff.Empty() {
+		s.publishLocked(cur, next)
+	}
+	return diff
+}
+
+// SetHealth updates the health of a single device and reports whether it
+// changed.
+func (s *deviceStore) SetHealth(id string, health string) bool {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	cur := s.current.Load()
+	old, ok := cur.devices[id]
+	if !ok || old.Health == health {
+		return false
+	}
+	next := make(map[string]*pluginapi.Device, len(cur.devices))
+	for k, device := range cur.devices {
+		next[k] = device
+	}
+	device := *old
+	device.Health = health
+	next[id] = &device
+	s.publishLocked(cur, next)
+	return true
+}
+
+func (s *deviceStore) Get(id string) (*pluginapi.Device, bool) {
+	device, ok := s.current.Load().devices[id]
+	return device, ok
+}
+
+// Snapshot returns the current version, the devices ordered by ID and a
+// channel closed by the next change. The slice must not be modified.
+func (s *deviceStore) Snapshot() (uint64, []*pluginapi.Device, <-chan struct{}) {
+	cur := s.current.Load()
+	return cur.version, cur.sorted, cur.changed
+}
+
+func (s *deviceStore) publishLocked(cur *deviceSnapshot, devices map[string]*pluginapi.Device) {
+	sorted := make([]*pluginapi.Device, 0, len(devices))
+	for _, device := range devices {
+		sorted = append(sorted, device)
+	}
+	sort.Slice(sorted, func(i, j int) bool { return lessID(sorted[i].ID, sorted[j].ID) })
+
+	s.current.Store(&deviceSnapshot{
+		version: cur.version + 1,
+		devices: devices,
+		sorted:  sorted,
+		changed: make(chan struct{}),
+	})
+	// wake the watchers only once the new snapshot is visible
+	close(cur.changed)
+}
+
+// lessID orders numeric device ids numerically ("2" before "10")
+func lessID(a, b string) bool {
+	if len(a) != len(b) {
+		return len(a) < len(b)
+	}
+	return a < b
+}
+
+// renderDevices appends the kubelet visible state of devices to buf, two
+// lists render the same bytes only if kubelet would see no difference.
+func renderDevices(buf []byte, devices []*pluginapi.Device) []byte {
+	for _, device := range devices {
+		buf = append(buf, device.ID...)
+		buf = append(buf, '=')
+		buf = append(buf, device.Health...)
+		buf = append(buf, ';')
+	}
+	return buf
+}
@@ -0,0 +1,408 @@
+package plugin
+
+import (
+	"fmt"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/pkg/errors"
+	"k8s.io/klog/v2"
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+
+	"gpu-device-plugin/pkg/common"
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/metrics"
+	"gpu-device-plugin/pkg/process"
+)
+
+// memSlices advertises every card as one ID per slice of its HBM, e.g.
+// "3::10" is the eleventh slice of card 3, so containers request memory
+// rather than whole cards. Like the replicas, the allocation state is the
+// one last seen through Allocate and GetPreferredAllocation.
+type memSlices struct {
+	size uint64 // bytes per slice
+
+	mu        sync.Mutex
+	slices    map[string]int              // card -> advertised slices
+	allocated map[string]bool             // slice ID -> allocated
+	used      map[string]uint64           // card -> HBM used by its processes, bytes
+	over      map[string]bool             // card -> processes exceed the allocated slices
+	offenders map[string][]containerUsage // card over its budget -> its containers
+
+	procs    []erml.ProcessInfo // reused by check
+	resolver *process.Resolver  // containers of the processes of a card over budget
+}
+
+func newMemSlices(gib int) (*memSlices, error) {
+	if gib < 1 {
+		return nil, fmt.Errorf("memory slice must be at least 1 GiB, got %d", gib)
+	}
+	return &memSlices{
+		size:      uint64(gib) << 30,
+		slices:    make(map[string]int),
+		allocated: make(map[string]bool),
+		used:      make(map[string]uint64),
+		over:      make(map[string]bool),
+		offenders: make(map[string][]containerUsage),
+		resolver:  process.NewResolver(common.ProcRoot),
+	}, nil
+}
+
+// sizing wraps the card scan to record how many slices fit in every card,
+// it runs inside the erml session like the scan itself
+func (m *memSlices) sizing(scan func() ([]*pluginapi.Device, error)) func() ([]*pluginapi.Device, error) {
+	return func() ([]*pluginapi.Device, error) {
+		devices, err := scan()
+		if err != nil {
+			return nil, err
+		}
+		slices := make(map[string]int, len(devices))
+		for _, device := range devices {
+			dev_idx, err := strconv.Atoi(device.ID)
+			if err != nil {
+				continue
+			}
+			handle := erml.DeviceByIndex(uint(dev_idx))
+			total, err := hbmTotal(handle)
+			if err != nil {
+				// one unreadable card must not withdraw the others
+				klog.Warningf("get dev [%d] hbm failed, no memory slices on it: %v", dev_idx, err)
+				slices[device.ID] = 0
+				continue
+			}
+			slices[device.ID] = int(total / m.size)
+		}
+		m.mu.Lock()
+		m.slices = slices
+		m.mu.Unlock()
+		return devices, nil
+	}
+}
+
+// hbmTotal returns the HBM capacity of a card in bytes, summed over its
+// clusters when the card does not report it as a whole
+func hbmTotal(handle erml.Device) (uint64, error) {
+	mem, err := handle.GetDevMem()
+	if err == nil && mem != nil && mem.Mem_Total_Size > 0 {
+		return uint64(mem.Mem_Total_Size) * common.MemUnit, nil
+	}
+	if err != nil && !isErmlCode(err, erml.ErrUnSupport) {
+		return 0, err
+	}
+	clusters, err := handle.GetClusterCount()
+	if err != nil {
+		return 0, err
+	}
+	var total uint64
+	for cluster := uint(0); cluster < clusters; cluster++ {
+		mem, err := handle.GetDevClusterHbmMem(cluster)
+		if err != nil {
+			return 0, errors.WithMessagef(err, "cluster [%d]", cluster)
+		}
+		total += uint64(mem.Mem_Total_Size) * common.MemUnit
+	}
+	return total, nil
+}
+
+// expand lists the slices of every card, they share its health
+func (m *memSlices) expand(devices []*pluginapi.Device) []*pluginapi.Device {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	n := 0
+	for _, device := range devices {
+		n += m.slices[device.ID]
+	}
+	ret := make([]*pluginapi.Device, 0, n)
+	for _, device := range devices {
+		for s := 0; s < m.slices[device.ID]; s++ {
+			ret = append(ret, &pluginapi.Device{ID: replicaID(device.ID, s), Health: device.Health, Topology: device.Topology})
+		}
+	}
+	return ret
+}
+
+// card maps a slice ID back to its card, rejecting slices above its HBM
+func (m *memSlices) card(id string) (string, error) {
+	card, s, ok := splitReplica(id)
+	m.mu.Lock()
+	n := m.slices[card]
+	m.mu.Unlock()
+	if !ok || s < 0 || s >= n {
+		return "", fmt.Errorf("invalid memory slice id %s, card has %d slices", id, n)
+	}
+	return card, nil
+}
+
+func (m *memSlices) markAllocated(ids []string) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	for _, id := range ids {
+		m.allocated[id] = true
+	}
+}
+
+// observeFree records that every slice of cards but the available ones is
+// allocated
+func (m *memSlices) observeFree(cards []*pluginapi.Device, available []string) {
+	free := make(map[string]struct{}, len(available))
+	for _, id := range available {
+		free[id] = struct{}{}
+	}
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	for _, device := range cards {
+		for s := 0; s < m.slices[device.ID]; s++ {
+			id := replicaID(device.ID, s)
+			_, ok := free[id]
+			m.allocated[id] = !ok
+		}
+	}
+}
+
+// limits renders the HBM budget of a container taking slices[i] slices of
+// the card ids[i], e.g. "1:2147483648,2:19327352832". prefer keeps a
+// request on one card when one has room, a spilled one gets a budget per
+// card rather than their sum.
+func (m *memSlices) limits(ids []string, slices []int) string {
+	buf := make([]byte, 0, len(ids)*16)
+	for i, id := range ids {
+		if i > 0 {
+			buf = append(buf, ',')
+		}
+		buf = append(buf, id...)
+		buf = append(buf, ':')
+		buf = strconv.AppendUint(buf, uint64(slices[i])*m.size, 10)
+	}
+	return string(buf)
+}
+
+// budgetLocked returns the HBM allocated on a card, in bytes
+func (m *memSlices) budgetLocked(card string) uint64 {
+	n := uint64(0)
+	for s := 0; s < m.slices[card]; s++ {
+		if m.allocated[replicaID(card, s)] {
+			n++
+		}
+	}
+	return n * m.size
+}
+
+// prefer packs size slices, keeping mustInclude, on a single card when one
+// has room, the fullest such card first so the emptier ones stay free for
+// larger requests. A request no card fits spills over the emptiest ones.
+func (m *memSlices) prefer(available, mustInclude []string, size int) []string {
+	free := make(map[string][]string) // card -> free slices
+	for _, id := range available {
+		card, _, ok := splitReplica(id)
+		if ok && !contains(mustInclude, id) {
+			free[card] = append(free[card], id)
+		}
+	}
+	cards := make([]string, 0, len(free))
+	for card, ids := range free {
+		sort.Slice(ids, func(i, j int) bool { return lessID(ids[i], ids[j]) })
+		cards = append(cards, card)
+	}
+	// fewest free slices first, the most packed cards
+	sort.Slice(cards, func(i, j int) bool {
+		if len(free[cards[i]]) != len(free[cards[j]]) {
+			return len(free[cards[i]]) < len(free[cards[j]])
+		}
+		return lessID(cards[i], cards[j])
+	})
+
+	ret := append([]string(nil), mustInclude...)
+	take := func(card string) {
+		for len(ret) < size && len(free[card]) > 0 {
+			ret = append(ret, free[card][0])
+			free[card] = free[card][1:]
+		}
+	}
+	// stay on the cards the devicemanager already picked
+	for _, id := range mustInclude {
+		if card, _, ok := splitReplica(id); ok {
+			take(card)
+		}
+	}
+	if want := size - len(ret); want > 0 {
+		for _, card := range cards {
+			if len(free[card]) >= want {
+				take(card)
+				break
+			}
+		}
+	}
+	for i := len(cards) - 1; i >= 0 && len(ret) < size; i-- {
+		take(cards[i])
+	}
+	if len(ret) < size {
+		return nil
+	}
+	return ret
+}
+
+// check compares the HBM used by the processes of every card with the
+// slices allocated on it and reports the cards whose containers outgrow
+// their budget, with the containers running on them. The plugin only sees
+// processes per card, so the budget is the one of all the containers
+// sharing it. A card without allocated slices has no budget to outgrow.
+func (m *memSlices) check(dm *DeviceMonitor) {
+	for _, device := range dm.Devices() {
+		dev_idx, err := strconv.Atoi(device.ID)
+		if err != nil {
+			continue
+		}
+		err = dm.session.Do(func() (err error) {
+			handle := erml.DeviceByIndex(uint(dev_idx))
+			m.procs, err = handle.AppendProcessInfo(m.procs[:0])
+			return
+		})
+		if err != nil {
+			if !isErmlCode(err, erml.ErrUnSupport) {
+				klog.Warningf("get dev [%d] process info failed: %v", dev_idx, err)
+			}
+			continue
+		}
+		var used uint64
+		for _, proc := range m.procs {
+			used += proc.DevMemUsage * common.MemUnit
+		}
+
+		m.mu.Lock()
+		budget := m.budgetLocked(device.ID)
+		over := budget > 0 && used > budget
+		changed := over != m.over[device.ID]
+		m.used[device.ID] = used
+		m.over[device.ID] = over
+		m.mu.Unlock()
+
+		var offenders []containerUsage
+		if over {
+			offenders = m.containers(device.ID)
+		}
+		m.setOffenders(device.ID, offenders)
+		if !changed {
+			continue
+		}
+		if over {
+			klog.Warningf("device [%d] processes use %d MiB of HBM, over the %d MiB allocated in slices: %s",
+				dev_idx, used>>20, budget>>20, describe(offenders))
+		} else {
+			klog.Infof("device [%d] processes are back within the %d MiB allocated in slices", dev_idx, budget>>20)
+		}
+	}
+	m.resolver.Sweep()
+}
+
+// containers charges the processes last read by check to their containers
+func (m *memSlices) containers(card string) []containerUsage {
+	totals := make(map[process.Container]*containerUsage)
+	var ret []containerUsage
+	for _, proc := range m.procs {
+		c, _ := m.resolver.Resolve(proc.Pid)
+		u, ok := totals[c]
+		if !ok {
+			ret = append(ret, containerUsage{
+				labels: `pod_uid="` + c.PodUID + `",container_id="` + c.ContainerID + `",device="` + card + `"`,
+			})
+			u = &ret[len(ret)-1]
+			totals[c] = u
+		}
+		u.mem += proc.DevMemUsage * common.MemUnit
+		u.processes++
+	}
+	sort.Slice(ret, func(i, j int) bool { return ret[i].mem > ret[j].mem })
+	return ret
+}
+
+func describe(usage []containerUsage) string {
+	parts := make([]string, 0, len(usage))
+	for _, u := range usage {
+		parts = append(parts, fmt.Sprintf("{%s} %d MiB", u.labels, u.mem>>20))
+	}
+	return strings.Join(parts, ", ")
+}
+
+// setOffenders publishes the containers of a card over its budget, none
+// once it is back within
+func (m *memSlices) setOffenders(card string, usage []containerUsage) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	if len(usage) == 0 {
+		delete(m.offenders, card)
+		return
+	}
+	m.offenders[card] = usage
+}
+
+// Run checks the slice budgets until stop is closed
+func (m *memSlices) Run(dm *DeviceMonitor, interval time.Duration, stop <-chan struct{}) {
+	ticker := time.NewTicker(interval)
+	defer ticker.Stop()
+	for {
+		m.check(dm)
+		select {
+		case <-ticker.C:
+		case <-stop:
+			return
+		}
+	}
+}
+
+// memGauge exports one value of the slice accounting of every card
+type memGauge struct {
+	dm    *DeviceMonitor
+	mem   *memSlices
+	value func(m *memSlices, card string) float64
+}
+
+func (g memGauge) DeviceCount() int {
+	return len(g.dm.Devices())
+}
+
+func (g memGauge) DeviceGauge(dev_idx int) (float64, bool) {
+	card := strconv.Itoa(dev_idx)
+	g.mem.mu.Lock()
+	defer g.mem.mu.Unlock()
+	if _, ok := g.mem.slices[card]; !ok {
+		return 0, false
+	}
+	return g.value(g.mem, card), true
+}
+
+// offenderGauge exports the HBM used by the containers of the cards over
+// their budget
+type offenderGauge struct {
+	mem *memSlices
+}
+
+func (g offenderGauge) EachGauge(fn func(labels string, v float64)) {
+	g.mem.mu.Lock()
+	defer g.mem.mu.Unlock()
+	cards := make([]string, 0, len(g.mem.offenders))
+	for card := range g.mem.offenders {
+		cards = append(cards, card)
+	}
+	sort.Slice(cards, func(i, j int) bool { return lessID(cards[i], cards[j]) })
+	for _, card := range cards {
+		for _, u := range g.mem.offenders[card] {
+			fn(u.labels, float64(u.mem))
+		}
+	}
+}
+
+func (m *memSlices) registerGauges(e *metrics.Exporter, dm *DeviceMonitor) {
+	e.Register("mem_slices", "HBM slices advertised for the card.", memGauge{dm, m,
+		func(m *memSlices, card string) float64 { return float64(m.slices[card]) }})
+	e.Register("mem_slice_budget_bytes", "HBM allocated on the card in slices.", memGauge{dm, m,
+		func(m *memSlices, card string) float64 { return float64(m.budgetLocked(card)) }})
+	e.Register("mem_slice_used_bytes", "HBM used by the processes of the card.", memGauge{dm, m,
+		func(m *memSlices, card string) float64 { return float64(m.used[card]) }})
+	e.Register("mem_slice_over_budget", "1 when the processes of the card use more HBM than allocated.", memGauge{dm, m,
+		func(m *memSlices, card string) float64 { return bool2float(m.over[card]) }})
+	e.RegisterLabeled("mem_slice_over_budget_container_bytes",
+		"HBM used by the containers of a card whose processes use more than allocated.", offenderGauge{m})
+}
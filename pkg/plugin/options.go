@@ -0,0 +1,74 @@
+package plugin
+
+import (
+	"path"
+	"time"
+
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+
+	"gpu-device-plugin/pkg/common"
+)
+
+// Options tunes the device plugin, DefaultOptions gives usable values for
+// every field
+type Options struct {
+	// CoalesceWindow merges device changes raised within the window into a
+	// single ListAndWatch update
+	CoalesceWindow time.Duration
+	// MetricsAddr is the listen address of the /metrics endpoint, empty
+	// disables it
+	MetricsAddr string
+	// MetricsInterval is the period of the telemetry sampling loop
+	MetricsInterval time.Duration
+	// UsageInterval is the period of the async usage sampling, zero
+	// disables it
+	UsageInterval time.Duration
+	// UsageWindow is the window of the exported usage statistics
+	UsageWindow time.Duration
+	// HeartbeatInterval is the period of the firmware heartbeat watchdog,
+	// zero disables it
+	HeartbeatInterval time.Duration
+	// HeartbeatStalls is the number of consecutive samples without a
+	// heartbeat after which a device is withdrawn
+	HeartbeatStalls int
+	// HealthInterval is the period of the health rule evaluation, zero
+	// disables it
+	HealthInterval time.Duration
+	// Replicas advertises every card as this many time-sliced replicas, 1
+	// disables sharing
+	Replicas int
+	// MemSlice advertises every card as slices of this many GiB of HBM,
+	// 0 disables it. Exclusive with Replicas.
+	MemSlice int
+	// MemCheckInterval is the period of the slice budget check
+	MemCheckInterval time.Duration
+	// ProcessInterval is the period of the per-container accounting of the
+	// device processes, zero disables it. It is only exported as metrics.
+	ProcessInterval time.Duration
+	// Vgcu also advertises the virtual GCUs as their own resource
+	Vgcu bool
+	// PluginDir holds the kubelet socket and the plugin sockets
+	PluginDir string
+}
+
+func DefaultOptions() Options {
+	return Options{
+		CoalesceWindow:    common.CoalesceWindow,
+		MetricsAddr:       common.MetricsAddr,
+		MetricsInterval:   common.MetricsInterval,
+		UsageInterval:     common.UsageInterval,
+		UsageWindow:       common.UsageWindow,
+		HeartbeatInterval: common.HeartbeatInterval,
+		HeartbeatStalls:   common.HeartbeatStalls,
+		HealthInterval:    common.HealthInterval,
+		Replicas:          1,
+		MemCheckInterval:  common.MemCheckInterval,
+		ProcessInterval:   common.ProcessInterval,
+		PluginDir:         pluginapi.DevicePluginPath,
+	}
+}
+
+// KubeletSocket is the registration socket of kubelet in PluginDir
+func (o Options) KubeletSocket() string {
+	return path.Join(o.PluginDir, path.Base(pluginapi.KubeletSocket))
+}
@@ -9,21 +9,22 @@ import (
 	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
 )
 
-// Register registers the device plugin for the given resourceName with Kubelet.
+// Register registers the device plugin for its resource with Kubelet.
 func (c *GpuDevicePlugin) Register() error {
-	conn, err := connect(pluginapi.KubeletSocket, common.ConnectTimeout)
+	kubelet := c.opts.KubeletSocket()
+	conn, err := connect(kubelet, common.ConnectTimeout)
 	if err != nil {
-		return errors.WithMessagef(err, "connect to %s failed", pluginapi.KubeletSocket)
+		return errors.WithMessagef(err, "connect to %s failed", kubelet)
 	}
 	defer conn.Close()
 
 	client := pluginapi.NewRegistrationClient(conn)
 	reqt := &pluginapi.RegisterRequest{
 		Version:      pluginapi.Version,
-		Endpoint:     path.Base(common.DeviceSocket),
-		ResourceName: common.ResourceName,
-		// 如果需要使用 GetPreferredAllocation，需要指定开启
-		// Options:      &pluginapi.DevicePluginOptions{GetPreferredAllocationAvailable: true},
+		Endpoint:     path.Base(c.res.socket),
+		ResourceName: c.res.name,
+		// GetPreferredAllocation places multi-card requests on the ESL/NUMA topology
+		Options: &pluginapi.DevicePluginOptions{PreStartRequired: true, GetPreferredAllocationAvailable: true},
 	}
 
 	_, err = client.Register(context.Background(), reqt)
@@ -0,0 +1,35 @@
+package plugin
+
+import (
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+
+	"gpu-device-plugin/pkg/common"
+)
+
+// resource is an extended resource advertised by one plugin instance,
+// every instance has its own socket and registration
+type resource struct {
+	name   string // extended resource name
+	socket string // socket name under the kubelet device plugin directory
+	env    string // env listing the allocated IDs
+	// scan lists the devices, it runs inside the erml session. The vGCU
+	// plugin sets its own.
+	scan func() ([]*pluginapi.Device, error)
+	// physical resources get the topology, events, watchdog, health rules
+	// and metrics, virtual ones follow their parent card
+	physical bool
+}
+
+var gcuResource = resource{
+	name:     common.ResourceName,
+	socket:   common.DeviceSocket,
+	env:      common.EnvName,
+	scan:     scan,
+	physical: true,
+}
+
+var vgcuResource = resource{
+	name:   common.VgcuResourceName,
+	socket: common.VgcuDeviceSocket,
+	env:    common.VgcuEnvName,
+}
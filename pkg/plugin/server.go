@@ -10,24 +10,143 @@ import (
 	"syscall"
 	"time"
 
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/health"
+	"gpu-device-plugin/pkg/metrics"
+	"gpu-device-plugin/pkg/topology"
+
 	"github.com/pkg/errors"
 	"google.golang.org/grpc"
 	"google.golang.org/grpc/credentials/insecure"
+	"k8s.io/klog/v2"
 	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
 )
 
 type GpuDevicePlugin struct {
-	server *grpc.Server
-	stop   chan struct{} // this channel signals to stop the device plugin
-	dm     *DeviceMonitor
+	res     resource
+	server  *grpc.Server
+	stop    chan struct{} // this channel signals to stop the device plugin
+	session *erml.Session
+	dm      *DeviceMonitor
+	topo    *topology.Topology // built at startup, nil when discovery failed
+	metrics *metrics.Exporter  // nil when the endpoint is disabled
+	wd      *Watchdog          // nil when the heartbeat watchdog is disabled
+	hm      *HealthMonitor     // nil when the health rules are disabled
+	share   *sharing           // nil unless cards are time-sliced
+	mem     *memSlices         // nil unless cards are sliced by HBM
+	acct    *Accountant        // nil when the process accounting is disabled
+	virt    *virtualCards      // nil unless the virtual GCUs are advertised
+	parent  *GpuDevicePlugin   // whole card plugin a vGCU plugin follows
+	vgcus   *vgcuParents       // nil unless the plugin advertises vGCUs
+	allocs  *allocCache
+	opts    Options
 }
 
-func NewGpuDevicePlugin() *GpuDevicePlugin {
+// NewGpuDevicePlugin opens the erml session shared by the scanner and the
+// gRPC handlers for the whole lifetime of the plugin.
+func NewGpuDevicePlugin(opts Options) (*GpuDevicePlugin, error) {
+	c, err := newPlugin(gcuResource, opts)
+	if err != nil {
+		return nil, err
+	}
+	session := c.session
+	if opts.Replicas > 1 {
+		if c.share, err = newSharing(opts.Replicas); err != nil {
+			_ = session.Close()
+			return nil, err
+		}
+	}
+	if opts.MemSlice > 0 {
+		if c.share != nil {
+			_ = session.Close()
+			return nil, errors.New("replicas and memory slices are exclusive")
+		}
+		if c.mem, err = newMemSlices(opts.MemSlice); err != nil {
+			_ = session.Close()
+			return nil, err
+		}
+		c.dm.scan = c.mem.sizing(c.dm.scan)
+	}
+	if opts.Vgcu {
+		c.virt = newVirtualCards()
+		c.dm.scan = c.virt.tracking(c.dm.scan)
+	}
+	if opts.MetricsAddr != "" {
+		var usage *metrics.UsageSampler
+		if opts.UsageInterval > 0 {
+			usage = metrics.NewUsageSampler(session, opts.UsageInterval)
+		}
+		c.metrics = metrics.NewExporter(opts.MetricsAddr, metrics.NewSampler(session, opts.MetricsInterval, opts.Vgcu),
+			usage, opts.UsageWindow)
+	}
+	if opts.HeartbeatInterval > 0 {
+		c.wd = NewWatchdog(c.dm, opts.HeartbeatInterval, opts.HeartbeatStalls)
+		if c.metrics != nil {
+			c.metrics.Register("heartbeat_age_seconds", "Time since the firmware heartbeat counter last moved.", c.wd)
+		}
+	}
+	if opts.HealthInterval > 0 {
+		pcie := health.NewPcieRule(common.PcieNakPerSecond)
+		c.hm = NewHealthMonitor(c.dm, opts.HealthInterval, pcie,
+			health.NewEngine(common.HealthRaise, common.HealthClear, health.DefaultRules(pcie)...))
+		if c.metrics != nil {
+			c.hm.registerPcieGauges(c.metrics)
+		}
+	}
+	if c.share != nil && c.metrics != nil {
+		c.metrics.RegisterLabeled("shared_replica_allocated", "1 when the replica of the card was last seen allocated.",
+			replicaGauge{dm: c.dm, sharing: c.share})
+	}
+	if c.mem != nil && c.metrics != nil {
+		c.mem.registerGauges(c.metrics, c.dm)
+	}
+	if opts.ProcessInterval > 0 && c.metrics != nil {
+		c.acct = NewAccountant(c.dm, opts.ProcessInterval, common.ProcRoot)
+		c.acct.registerGauges(c.metrics)
+	}
+	return c, nil
+}
+
+// NewVgcuDevicePlugin advertises the virtual GCUs of every card as their
+// own resource, next to the whole cards of parent. A vGCU takes the
+// health parent combines for its card.
+func NewVgcuDevicePlugin(opts Options, parent *GpuDevicePlugin) (*GpuDevicePlugin, error) {
+	c, err := newPlugin(vgcuResource, opts)
+	if err != nil {
+		return nil, err
+	}
+	c.parent = parent
+	c.vgcus = newVgcuParents()
+	c.dm.scan = c.vgcus.scan
+	return c, nil
+}
+
+func newPlugin(res resource, opts Options) (*GpuDevicePlugin, error) {
+	session, err := erml.OpenSession(false)
+	if err != nil {
+		return nil, errors.WithMessage(err, "init erml failed")
+	}
 	return &GpuDevicePlugin{
-		server: grpc.NewServer(grpc.EmptyServerOption{}),
-		stop:   make(chan struct{}),
-		dm:     NewDeviceMonitor(common.DevicePath),
+		res:     res,
+		server:  grpc.NewServer(grpc.EmptyServerOption{}),
+		stop:    make(chan struct{}),
+		session: session,
+		dm:      NewDeviceMonitor(common.DevicePath, session, res.scan),
+		allocs:  newAllocCache(),
+		opts:    opts,
+	}, nil
+}
+
+// Stop shuts the gRPC server down and releases the erml session
+func (c *GpuDevicePlugin) Stop() {
+	close(c.stop)
+	c.server.Stop()
+	if c.metrics != nil {
+		ctx, cancel := context.WithTimeout(context.Background(), common.ConnectTimeout)
+		_ = c.metrics.Shutdown(ctx)
+		cancel()
 	}
+	_ = c.session.Close()
 }
 
 // Run start gRPC server and watcher
@@ -36,10 +155,58 @@ func (c *GpuDevicePlugin) Run() error {
 	if err != nil {
 		log.Fatalf("list device error: %v", err)
 	}
+	c.warmAllocs()
+
+	if c.res.physical {
+		c.topo, err = c.dm.discoverTopology()
+		if err != nil {
+			klog.Warningf("discover device topology failed, preferred allocation disabled: %v", err)
+		}
+
+		// events push health changes immediately, the rescan reconciles the rest
+		go func() {
+			if err := c.dm.WatchEvents(); err != nil {
+				klog.Errorf("device event watcher exited: %v", err)
+			}
+		}()
+	} else if c.parent != nil {
+		// kubelet must not get a vGCU of an unhealthy card in the first list
+		c.syncParents()
+		go c.followParents()
+	}
+	go func() {
+		if err := c.dm.Watch(); err != nil {
+			klog.Errorf("device watcher exited: %v", err)
+		}
+	}()
+	if c.wd != nil {
+		go c.wd.Run(c.stop)
+	}
+	if c.hm != nil {
+		go c.hm.Run(c.stop)
+	}
+	if c.mem != nil && c.opts.MemCheckInterval > 0 {
+		go c.mem.Run(c.dm, c.opts.MemCheckInterval, c.stop)
+	}
+	if c.acct != nil {
+		go c.acct.Run(c.stop)
+	}
+
+	if c.metrics != nil {
+		go c.metrics.Sampler().Run(c.stop)
+		if usage := c.metrics.UsageSampler(); usage != nil {
+			go usage.Run(c.stop)
+		}
+		go func() {
+			if err := c.metrics.Serve(); err != nil {
+				klog.Errorf("metrics endpoint exited: %v", err)
+			}
+		}()
+	}
 
 	pluginapi.RegisterDevicePluginServer(c.server, c)
 	// delete old unix socket before start
-	socket := path.Join(pluginapi.DevicePluginPath, common.DeviceSocket)
+	socket := path.Join(c.opts.PluginDir, c.res.socket)
 	err = syscall.Unlink(socket)
 	if err != nil && !os.IsNotExist(err) {
 		return errors.WithMessagef(err, "delete socket %s failed", socket)
@@ -53,7 +220,7 @@ func (c *GpuDevicePlugin) Run() error {
 	go c.server.Serve(sock)
 
 	// Wait for server to start by launching a blocking connection
-	conn, err := connect(common.DeviceSocket, 5*time.Second)
+	conn, err := connect(socket, 5*time.Second)
 	if err != nil {
 		return err
 	}
@@ -0,0 +1,194 @@
+package plugin
+
+import (
+	"fmt"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+
+	"gpu-device-plugin/pkg/common"
+)
+
+// replicaSep separates the card from the replica index in a shared device
+// ID, e.g. "3::1" is the second replica of card 3
+const replicaSep = "::"
+
+// sharing advertises every card as several replica IDs so containers using
+// a fraction of a card can be time-sliced on it. Kubelet does not report
+// releases, so the allocation state is the one last seen through Allocate
+// and the free IDs passed to GetPreferredAllocation.
+type sharing struct {
+	replicas int
+
+	mu        sync.Mutex
+	allocated map[string]bool   // replica ID -> allocated
+	labels    map[string]string // replica ID -> rendered metric labels
+}
+
+func newSharing(replicas int) (*sharing, error) {
+	if replicas < 1 || replicas > common.MaxReplicas {
+		return nil, fmt.Errorf("replicas per card must be within 1 and %d, got %d", common.MaxReplicas, replicas)
+	}
+	return &sharing{replicas: replicas, allocated: make(map[string]bool), labels: make(map[string]string)}, nil
+}
+
+func replicaID(id string, replica int) string {
+	return id + replicaSep + strconv.Itoa(replica)
+}
+
+// splitReplica returns the card and the replica index of a replica ID
+func splitReplica(id string) (string, int, bool) {
+	card, replica, ok := strings.Cut(id, replicaSep)
+	if !ok {
+		return id, 0, false
+	}
+	r, err := strconv.Atoi(replica)
+	if err != nil {
+		return id, 0, false
+	}
+	return card, r, true
+}
+
+// expand lists the replicas of every card, they share its health
+func (s *sharing) expand(devices []*pluginapi.Device) []*pluginapi.Device {
+	ret := make([]*pluginapi.Device, 0, len(devices)*s.replicas)
+	for _, device := range devices {
+		for r := 0; r < s.replicas; r++ {
+			ret = append(ret, &pluginapi.Device{ID: replicaID(device.ID, r), Health: device.Health, Topology: device.Topology})
+		}
+	}
+	return ret
+}
+
+// card maps a replica ID back to its card, rejecting replicas above the cap
+func (s *sharing) card(id string) (string, error) {
+	card, r, ok := splitReplica(id)
+	if !ok || r < 0 || r >= s.replicas {
+		return "", fmt.Errorf("invalid replica id %s, %d replicas per card", id, s.replicas)
+	}
+	return card, nil
+}
+
+func (s *sharing) markAllocated(ids []string) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	for _, id := range ids {
+		s.allocated[id] = true
+	}
+}
+
+// observeFree records that every replica of cards but the available ones
+// is allocated
+func (s *sharing) observeFree(cards []*pluginapi.Device, available []string) {
+	free := make(map[string]struct{}, len(available))
+	for _, id := range available {
+		free[id] = struct{}{}
+	}
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	for _, device := range cards {
+		for r := 0; r < s.replicas; r++ {
+			id := replicaID(device.ID, r)
+			_, ok := free[id]
+			s.allocated[id] = !ok
+		}
+	}
+}
+
+// prefer picks size replicas, keeping mustInclude, spread over as many
+// cards as possible. selectCards chooses the cards, nil lets prefer take
+// the ones with the most free replicas.
+func (s *sharing) prefer(available, mustInclude []string, size int, selectCards func(cards, must []string, size int) []string) []string {
+	free := make(map[string][]string) // card -> free replicas
+	for _, id := range available {
+		card, _, ok := splitReplica(id)
+		if ok && !contains(mustInclude, id) {
+			free[card] = append(free[card], id)
+		}
+	}
+	for _, ids := range free {
+		sort.Strings(ids)
+	}
+
+	ret := append([]string(nil), mustInclude...)
+	var mustCards []string
+	for _, id := range mustInclude {
+		if card, _, ok := splitReplica(id); ok && !contains(mustCards, card) {
+			mustCards = append(mustCards, card)
+		}
+	}
+	cards := make([]string, 0, len(free))
+	for card := range free {
+		cards = append(cards, card)
+	}
+	// most free replicas first, the least loaded cards
+	sort.Slice(cards, func(i, j int) bool {
+		if len(free[cards[i]]) != len(free[cards[j]]) {
+			return len(free[cards[i]]) > len(free[cards[j]])
+		}
+		return lessID(cards[i], cards[j])
+	})
+
+	// one replica per card first
+	want := size - len(ret)
+	if want > 0 {
+		chosen := cards
+		if selectCards != nil {
+			n := len(mustCards) + want
+			if n > len(cards)+len(mustCards) {
+				n = len(cards) + len(mustCards)
+			}
+			if picked := selectCards(append(cards, mustCards...), mustCards, n); picked != nil {
+				chosen = picked
+			}
+		}
+		for _, card := range chosen {
+			if len(ret) == size {
+				break
+			}
+			if contains(mustCards, card) || len(free[card]) == 0 {
+				continue
+			}
+			ret = append(ret, free[card][0])
+			free[card] = free[card][1:]
+		}
+	}
+	// then stack the rest on the least loaded cards
+	for _, card := range cards {
+		for len(ret) < size && len(free[card]) > 0 {
+			ret = append(ret, free[card][0])
+			free[card] = free[card][1:]
+		}
+	}
+	if len(ret) < size {
+		return nil
+	}
+	return ret
+}
+
+// replicaGauge exports one series per replica of every card, 1 when it
+// was last seen allocated
+type replicaGauge struct {
+	dm      *DeviceMonitor
+	sharing *sharing
+}
+
+func (g replicaGauge) EachGauge(fn func(labels string, v float64)) {
+	devices := g.dm.Devices()
+	g.sharing.mu.Lock()
+	defer g.sharing.mu.Unlock()
+	for _, device := range devices {
+		for r := 0; r < g.sharing.replicas; r++ {
+			id := replicaID(device.ID, r)
+			labels, ok := g.sharing.labels[id]
+			if !ok {
+				labels = `device="` + device.ID + `",replica="` + strconv.Itoa(r) + `"`
+				g.sharing.labels[id] = labels
+			}
+			fn(labels, bool2float(g.sharing.allocated[id]))
+		}
+	}
+}
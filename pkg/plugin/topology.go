@@ -0,0 +1,78 @@
+package plugin
+
+import (
+	"fmt"
+	"path/filepath"
+
+	"github.com/pkg/errors"
+	"k8s.io/klog/v2"
+
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/topology"
+)
+
+const pciDevicesPath = "/sys/bus/pci/devices/"
+
+// discoverTopology collects the ESL links, NUMA node and PCIe switch of
+// every card. Missing pieces only lower the quality of the placement, so
+// they are logged and skipped.
+func (d *DeviceMonitor) discoverTopology() (topo *topology.Topology, err error) {
+	err = d.session.Do(func() error {
+		cnt, err := erml.DeviceCount()
+		if err != nil {
+			return errors.WithMessage(err, "get dev count failed")
+		}
+
+		devices := make([]topology.Device, 0, cnt)
+		for dev_idx := uint(0); dev_idx < cnt; dev_idx++ {
+			handle := erml.DeviceByIndex(dev_idx)
+			device := topology.Device{ID: fmt.Sprintf("%d", dev_idx), Numa: -1}
+
+			if node, err := handle.GetNumaNode(); err == nil {
+				device.Numa = node
+			} else {
+				klog.Warningf("get dev [%d] numa node failed: %v", dev_idx, err)
+			}
+
+			if bdf, err := handle.GetBdf(); err == nil {
+				device.PcieSwitch = pcieSwitch(bdf)
+			} else {
+				klog.Warningf("get dev [%d] bdf failed: %v", dev_idx, err)
+			}
+
+			device.Esl = eslPeers(handle)
+			klog.Infof("device [%s] numa %d switch %q esl peers %v", device.ID, device.Numa, device.PcieSwitch, device.Esl)
+			devices = append(devices, device)
+		}
+		topo = topology.New(devices)
+		return nil
+	})
+	return
+}
+
+// eslPeers lists the cards connected to the ESL ports of a card
+func eslPeers(handle erml.Device) []string {
+	num, err := handle.GetEslPortNum()
+	if err != nil {
+		return nil
+	}
+	var peers []string
+	for port_idx := uint(0); port_idx < num; port_idx++ {
+		port, err := handle.GetEslPortInfo(port_idx)
+		if err != nil || port == nil || port.Connected == 0 {
+			continue
+		}
+		peers = append(peers, fmt.Sprintf("%d", port.Remote_Card_Id))
+	}
+	return peers
+}
+
+// pcieSwitch returns the sysfs path of the switch above a PCIe function:
+// /sys/devices/pci0000:00/<root port>/<switch up>/<switch down>/<bdf>
+func pcieSwitch(bdf string) string {
+	real, err := filepath.EvalSymlinks(pciDevicesPath + bdf)
+	if err != nil {
+		return ""
+	}
+	return filepath.Dir(filepath.Dir(real))
+}
@@ -0,0 +1,199 @@
+package plugin
+
+import (
+	"fmt"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+
+	"github.com/pkg/errors"
+	"k8s.io/klog/v2"
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/health"
+)
+
+// vgcuParents lists the virtual GCUs of every card and remembers the card
+// each one belongs to. A virtual device is exposed by the driver as its
+// own gcu node, its ID is the node index and its health is the one of the
+// parent card, reported by the whole card plugin.
+type vgcuParents struct {
+	parents atomic.Pointer[map[string]string] // vdev -> card
+	vdevs   []uint                            // reused across scans
+}
+
+func newVgcuParents() *vgcuParents {
+	p := &vgcuParents{}
+	p.parents.Store(&map[string]string{})
+	return p
+}
+
+// scan runs inside the erml session, the vdevs are listed healthy and
+// follow their card through the sourceParent verdict
+func (p *vgcuParents) scan() ([]*pluginapi.Device, error) {
+	devices := make([]*pluginapi.Device, 0)
+	parents := make(map[string]string)
+
+	cnt, err := erml.DeviceCount()
+	if err != nil {
+		return nil, errors.WithMessage(err, "get dev count failed")
+	}
+	for dev_idx := uint(0); dev_idx < cnt; dev_idx++ {
+		handle := erml.DeviceByIndex(dev_idx)
+		p.vdevs, err = handle.AppendVdevList(p.vdevs[:0])
+		if err != nil {
+			if isErmlCode(err, erml.ErrUnSupport) {
+				continue
+			}
+			return nil, errors.WithMessagef(err, "get dev [%d] vdev list failed", dev_idx)
+		}
+		card := fmt.Sprintf("%d", dev_idx)
+		for _, vdev_idx := range p.vdevs {
+			id := fmt.Sprintf("%d", vdev_idx)
+			parents[id] = card
+			devices = append(devices, &pluginapi.Device{
+				ID:     id,
+				Health: pluginapi.Healthy,
+			})
+		}
+	}
+	p.parents.Store(&parents)
+	return devices, nil
+}
+
+// syncParents reports the combined health of the parent card of every
+// vGCU, as the whole card plugin sees it
+func (c *GpuDevicePlugin) syncParents() {
+	for vdev, card := range *c.vgcus.parents.Load() {
+		v := c.parent.dm.health.get(card)
+		if v.Level != health.Healthy {
+			v.Reason = "card " + card + ": " + v.Reason
+		}
+		c.dm.Report(vdev, sourceParent, v)
+	}
+}
+
+// followParents re-publishes the health of the vGCUs whenever the cards
+// change and once the vGCUs are rescanned, until the plugin stops
+func (c *GpuDevicePlugin) followParents() {
+	for {
+		_, _, cards := c.parent.dm.store.Snapshot()
+		_, _, vdevs := c.dm.store.Snapshot()
+		c.syncParents()
+		select {
+		case <-cards:
+		case <-vdevs:
+		case <-c.stop:
+			return
+		}
+	}
+}
+
+// virtualCards is the set of cards split into virtual GCUs. With -vgcu
+// they stay in the store, so the health sources keep covering them, but
+// are not advertised as whole cards: kubelet would otherwise hand out a
+// card and its vGCUs to different containers.
+type virtualCards struct {
+	mu      sync.Mutex // serializes writers
+	current atomic.Pointer[virtualSnapshot]
+	vdevs   []uint // reused across scans
+}
+
+// virtualSnapshot is never modified once published
+type virtualSnapshot struct {
+	cards   map[string]struct{}
+	changed chan struct{} // closed when the next set is published
+}
+
+func newVirtualCards() *virtualCards {
+	v := &virtualCards{}
+	v.current.Store(&virtualSnapshot{cards: map[string]struct{}{}, changed: make(chan struct{})})
+	return v
+}
+
+// tracking wraps the scan of the cards to record which ones have vdevs,
+// it runs inside the erml session like the scan
+func (v *virtualCards) tracking(scan func() ([]*pluginapi.Device, error)) func() ([]*pluginapi.Device, error) {
+	return func() ([]*pluginapi.Device, error) {
+		devices, err := scan()
+		if err != nil {
+			return nil, err
+		}
+		cards := make(map[string]struct{})
+		for _, device := range devices {
+			dev_idx, err := strconv.Atoi(device.ID)
+			if err != nil {
+				continue
+			}
+			v.vdevs, err = erml.DeviceByIndex(uint(dev_idx)).AppendVdevList(v.vdevs[:0])
+			if err != nil {
+				if isErmlCode(err, erml.ErrUnSupport) {
+					continue
+				}
+				return nil, errors.WithMessagef(err, "get dev [%d] vdev list failed", dev_idx)
+			}
+			if len(v.vdevs) > 0 {
+				cards[device.ID] = struct{}{}
+			}
+		}
+		v.set(cards)
+		return devices, nil
+	}
+}
+
+func (v *virtualCards) set(cards map[string]struct{}) {
+	v.mu.Lock()
+	defer v.mu.Unlock()
+	cur := v.current.Load()
+	if len(cards) == len(cur.cards) {
+		same := true
+		for id := range cards {
+			if _, ok := cur.cards[id]; !ok {
+				same = false
+				break
+			}
+		}
+		if same {
+			return
+		}
+	}
+	ids := make([]string, 0, len(cards))
+	for id := range cards {
+		ids = append(ids, id)
+	}
+	sort.Slice(ids, func(i, j int) bool { return lessID(ids[i], ids[j]) })
+	klog.Infof("cards split into vgcus, not advertised whole: [%s]", strings.Join(ids, ","))
+	v.current.Store(&virtualSnapshot{cards: cards, changed: make(chan struct{})})
+	close(cur.changed)
+}
+
+// has reports whether a card is split into vGCUs, a nil set has none
+func (v *virtualCards) has(id string) bool {
+	if v == nil {
+		return false
+	}
+	_, ok := v.current.Load().cards[id]
+	return ok
+}
+
+// hide drops the virtualized cards from devices and returns a channel
+// closed when the set changes, nil for a nil set
+func (v *virtualCards) hide(devices []*pluginapi.Device) ([]*pluginapi.Device, <-chan struct{}) {
+	if v == nil {
+		return devices, nil
+	}
+	cur := v.current.Load()
+	if len(cur.cards) == 0 {
+		return devices, cur.changed
+	}
+	ret := make([]*pluginapi.Device, 0, len(devices))
+	for _, device := range devices {
+		if _, ok := cur.cards[device.ID]; !ok {
+			ret = append(ret, device)
+		}
+	}
+	return ret, cur.changed
+}
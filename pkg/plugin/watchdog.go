@@ -0,0 +1,134 @@
+package plugin
+
+import (
+	"fmt"
+	"sync/atomic"
+	"time"
+
+	"k8s.io/klog/v2"
+
+	"gpu-device-plugin/pkg/erml"
+	"gpu-device-plugin/pkg/health"
+)
+
+// Watchdog samples the SSM firmware heartbeat counter of every device. A
+// counter left unchanged for stalls consecutive samples means the firmware
+// hung, which erml health often never reports, so the device is withdrawn
+// until the counter moves again.
+type Watchdog struct {
+	dm       *DeviceMonitor
+	interval time.Duration
+	stalls   int
+	beats    atomic.Pointer[[]*heartbeat] // indexed by device index
+}
+
+type heartbeat struct {
+	count     uint
+	same      int          // consecutive samples without a beat
+	lastBeat  atomic.Int64 // unix nano of the last counter change
+	stalled   bool         // the watchdog reported the device unhealthy
+	supported bool
+}
+
+func NewWatchdog(dm *DeviceMonitor, interval time.Duration, stalls int) *Watchdog {
+	return &Watchdog{dm: dm, interval: interval, stalls: stalls}
+}
+
+// Run samples until stop is closed
+func (w *Watchdog) Run(stop <-chan struct{}) {
+	klog.Infof("watching firmware heartbeat every %v, stalled after %d samples", w.interval, w.stalls)
+	ticker := time.NewTicker(w.interval)
+	defer ticker.Stop()
+	for {
+		w.sample(time.Now())
+		select {
+		case <-ticker.C:
+		case <-stop:
+			return
+		}
+	}
+}
+
+func (w *Watchdog) sample(now time.Time) {
+	beats := w.resize(len(w.dm.Devices()))
+	for dev_idx, beat := range beats {
+		var count uint
+		err := w.dm.session.Do(func() (err error) {
+			handle := erml.DeviceByIndex(uint(dev_idx))
+			count, err = handle.GetSsmFwHeartBeat()
+			return
+		})
+		if err != nil {
+			if beat.supported {
+				klog.Warningf("read dev [%d] heartbeat failed: %v", dev_idx, err)
+			}
+			continue
+		}
+		if !beat.supported || count != beat.count {
+			beat.supported = true
+			beat.count = count
+			beat.same = 0
+			beat.lastBeat.Store(now.UnixNano())
+		} else {
+			beat.same++
+		}
+		w.check(dev_idx, beat, now)
+	}
+}
+
+func (w *Watchdog) check(dev_idx int, beat *heartbeat, now time.Time) {
+	id := fmt.Sprintf("%d", dev_idx)
+	switch {
+	case beat.same >= w.stalls && !beat.stalled:
+		beat.stalled = true
+		w.dm.Report(id, sourceHeartbeat, health.Verdict{Level: health.Unhealthy,
+			Reason: fmt.Sprintf("firmware heartbeat stalled at %d since %s", beat.count,
+				time.Unix(0, beat.lastBeat.Load()).Format(time.RFC3339))})
+	case beat.same < w.stalls && beat.stalled:
+		beat.stalled = false
+		klog.Infof("device [%s] firmware heartbeat resumed", id)
+		w.dm.Report(id, sourceHeartbeat, health.Verdict{})
+	}
+}
+
+// resize keeps the state of known devices and publishes the slice when the
+// device count changed
+func (w *Watchdog) resize(n int) []*heartbeat {
+	var beats []*heartbeat
+	if p := w.beats.Load(); p != nil {
+		beats = *p
+	}
+	if len(beats) == n {
+		return beats
+	}
+	next := make([]*heartbeat, n)
+	copy(next, beats)
+	for i := range next {
+		if next[i] == nil {
+			next[i] = &heartbeat{}
+		}
+	}
+	w.beats.Store(&next)
+	return next
+}
+
+// DeviceCount and DeviceGauge export the time since the last heartbeat of
+// every device, in seconds
+func (w *Watchdog) DeviceCount() int {
+	if p := w.beats.Load(); p != nil {
+		return len(*p)
+	}
+	return 0
+}
+
+func (w *Watchdog) DeviceGauge(dev_idx int) (float64, bool) {
+	p := w.beats.Load()
+	if p == nil || dev_idx >= len(*p) {
+		return 0, false
+	}
+	last := (*p)[dev_idx].lastBeat.Load()
+	if last == 0 {
+		return 0, false
+	}
+	return time.Since(time.Unix(0, last)).Seconds(), true
+}
@@ -0,0 +1,93 @@
+package process
+
+import (
+	"bytes"
+	"strings"
+)
+
+// Container identifies the kubernetes container a process runs in
+type Container struct {
+	PodUID      string
+	ContainerID string
+}
+
+// parseCgroup finds the pod and container in the content of
+// /proc/<pid>/cgroup. Both the cgroupfs layout, e.g.
+//
+//	/kubepods/burstable/pod<uid>/<id>
+//
+// and the systemd one, e.g.
+//
+//	/kubepods.slice/kubepods-burstable.slice/kubepods-burstable-pod<uid>.slice/cri-containerd-<id>.scope
+//
+// are understood, for cgroup v1 and v2.
+func parseCgroup(data []byte) (Container, bool) {
+	for len(data) > 0 {
+		line := data
+		if i := bytes.IndexByte(data, '\n'); i >= 0 {
+			line, data = data[:i], data[i+1:]
+		} else {
+			data = nil
+		}
+		// hierarchy-ID:controller-list:cgroup-path
+		parts := bytes.SplitN(line, []byte(":"), 3)
+		if len(parts) != 3 {
+			continue
+		}
+		if c, ok := parsePath(string(parts[2])); ok {
+			return c, true
+		}
+	}
+	return Container{}, false
+}
+
+// parsePath looks for the pod below the kubepods cgroup, so that e.g. a
+// podman scope elsewhere is not taken for a pod
+func parsePath(path string) (Container, bool) {
+	segments := strings.Split(path, "/")
+	kubepods := false
+	for i, seg := range segments {
+		if !kubepods {
+			kubepods = strings.Contains(seg, "kubepods")
+			if !kubepods {
+				continue
+			}
+		}
+		uid, ok := podUID(seg)
+		if !ok {
+			continue
+		}
+		c := Container{PodUID: uid}
+		if i+1 < len(segments) {
+			c.ContainerID = containerID(segments[i+1])
+		}
+		return c, true
+	}
+	return Container{}, false
+}
+
+// podUID extracts the pod UID of a "pod<uid>" or a
+// "kubepods-<qos>-pod<uid_with_underscores>.slice" segment
+func podUID(seg string) (string, bool) {
+	if strings.HasSuffix(seg, ".slice") {
+		i := strings.LastIndex(seg, "-pod")
+		if i < 0 {
+			return "", false
+		}
+		return strings.ReplaceAll(strings.TrimSuffix(seg[i+len("-pod"):], ".slice"), "_", "-"), true
+	}
+	if strings.HasPrefix(seg, "pod") && len(seg) > len("pod") {
+		return seg[len("pod"):], true
+	}
+	return "", false
+}
+
+// containerID strips the runtime prefix and the scope suffix systemd adds,
+// e.g. "cri-containerd-<id>.scope", "docker-<id>.scope" or "crio-<id>.scope"
+func containerID(seg string) string {
+	seg = strings.TrimSuffix(seg, ".scope")
+	if i := strings.LastIndexByte(seg, '-'); i >= 0 {
+		seg = seg[i+1:]
+	}
+	return seg
+}
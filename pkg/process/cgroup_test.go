@@ -0,0 +1,97 @@
+package process
+
+import "testing"
+
+func TestParseCgroup(t *testing.T) {
+	const (
+		uid  = "8f0c3a2e-5b1d-4c6e-9a7f-2d4b6c8e0a1f"
+		suid = "8f0c3a2e_5b1d_4c6e_9a7f_2d4b6c8e0a1f" // as systemd escapes it
+		id   = "3f4e5d6c7b8a9f0e1d2c3b4a5f6e7d8c9b0a1f2e3d4c5b6a7f8e9d0c1b2a3f4e"
+	)
+	for _, c := range []struct {
+		name   string
+		cgroup string
+		want   Container
+		ok     bool
+	}{
+		{"systemd v2 burstable containerd",
+			"0::/kubepods.slice/kubepods-burstable.slice/kubepods-burstable-pod" + suid + ".slice/cri-containerd-" + id + ".scope\n",
+			Container{uid, id}, true},
+		{"systemd v2 besteffort crio",
+			"0::/kubepods.slice/kubepods-besteffort.slice/kubepods-besteffort-pod" + suid + ".slice/crio-" + id + ".scope\n",
+			Container{uid, id}, true},
+		{"systemd v1 burstable docker",
+			"12:memory:/kubepods.slice/kubepods-burstable.slice/kubepods-burstable-pod" + suid + ".slice/docker-" + id + ".scope\n" +
+				"11:cpu,cpuacct:/kubepods.slice/kubepods-burstable.slice/kubepods-burstable-pod" + suid + ".slice/docker-" + id + ".scope\n",
+			Container{uid, id}, true},
+		{"systemd guaranteed",
+			"0::/kubepods.slice/kubepods-pod" + suid + ".slice/cri-containerd-" + id + ".scope",
+			Container{uid, id}, true},
+		{"systemd under a kubelet slice",
+			"0::/kubelet.slice/kubelet-kubepods.slice/kubelet-kubepods-besteffort.slice/kubelet-kubepods-besteffort-pod" + suid + ".slice/cri-containerd-" + id + ".scope",
+			Container{uid, id}, true},
+		{"cgroupfs v1 burstable",
+			"12:memory:/kubepods/burstable/pod" + uid + "/" + id + "\n",
+			Container{uid, id}, true},
+		{"cgroupfs v2 besteffort",
+			"0::/kubepods/besteffort/pod" + uid + "/" + id + "\n",
+			Container{uid, id}, true},
+		{"cgroupfs guaranteed",
+			"0::/kubepods/pod" + uid + "/" + id,
+			Container{uid, id}, true},
+		{"cgroupfs after a non-pod line",
+			"1:name=systemd:/\n4:memory:/kubepods/burstable/pod" + uid + "/" + id + "\n",
+			Container{uid, id}, true},
+		{"pod without container",
+			"0::/kubepods/burstable/pod" + uid,
+			Container{uid, ""}, true},
+		{"host service", "0::/system.slice/containerd.service\n", Container{}, false},
+		{"user session", "0::/user.slice/user-1000.slice/session-3.scope\n", Container{}, false},
+		{"podman outside kubepods", "0::/machine.slice/libpod-" + id + ".scope\n" +
+			"1:name=systemd:/system.slice/podman-1234.scope\n", Container{}, false},
+		{"root", "0::/\n", Container{}, false},
+		{"empty", "", Container{}, false},
+	} {
+		got, ok := parseCgroup([]byte(c.cgroup))
+		if ok != c.ok || got != c.want {
+			t.Errorf("%s: got %+v %v, want %+v %v", c.name, got, ok, c.want, c.ok)
+		}
+	}
+}
+
+func TestPodUID(t *testing.T) {
+	for _, c := range []struct {
+		seg  string
+		want string
+		ok   bool
+	}{
+		{"pod1234-ab", "1234-ab", true},
+		{"kubepods-burstable-pod1234_ab.slice", "1234-ab", true},
+		{"kubepods-pod1234_ab.slice", "1234-ab", true},
+		{"kubepods-burstable.slice", "", false},
+		{"kubepods.slice", "", false},
+		{"pod", "", false},
+		{"burstable", "", false},
+	} {
+		got, ok := podUID(c.seg)
+		if ok != c.ok || got != c.want {
+			t.Errorf("%s: got %q %v, want %q %v", c.seg, got, ok, c.want, c.ok)
+		}
+	}
+}
+
+func TestContainerID(t *testing.T) {
+	for _, c := range []struct {
+		seg  string
+		want string
+	}{
+		{"cri-containerd-abc123.scope", "abc123"},
+		{"crio-abc123.scope", "abc123"},
+		{"docker-abc123.scope", "abc123"},
+		{"abc123", "abc123"},
+	} {
+		if got := containerID(c.seg); got != c.want {
+			t.Errorf("%s: got %q, want %q", c.seg, got, c.want)
+		}
+	}
+}
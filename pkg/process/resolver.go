@@ -0,0 +1,103 @@
+package process
+
+import (
+	"bytes"
+	"fmt"
+	"os"
+	"path/filepath"
+	"strconv"
+	"sync"
+)
+
+// Resolver maps PIDs to their containers through /proc/<pid>/cgroup. The
+// cgroup of a PID is only read once while it lives, a hit is checked
+// against the start time of /proc/<pid>/stat so a recycled PID is resolved
+// again. Entries of the PIDs not resolved since the previous Sweep are
+// dropped as exited.
+type Resolver struct {
+	root string // procfs mount, the host one when running with hostPID
+
+	mu    sync.Mutex
+	cache map[uint]*entry
+	gen   uint64
+}
+
+type entry struct {
+	container Container
+	ok        bool   // false for processes outside any pod
+	start     uint64 // start time of the process, in clock ticks after boot
+	gen       uint64
+}
+
+func NewResolver(root string) *Resolver {
+	return &Resolver{root: root, cache: make(map[uint]*entry)}
+}
+
+// Resolve returns the container of pid, false when the process runs outside
+// of any pod or is gone
+func (r *Resolver) Resolve(pid uint) (Container, bool) {
+	dir := filepath.Join(r.root, strconv.FormatUint(uint64(pid), 10))
+	start, err := startTime(dir)
+
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	if err != nil {
+		// exited or not visible, try again next time
+		delete(r.cache, pid)
+		return Container{}, false
+	}
+	if e, ok := r.cache[pid]; ok && e.start == start {
+		e.gen = r.gen
+		return e.container, e.ok
+	}
+	data, err := os.ReadFile(filepath.Join(dir, "cgroup"))
+	if err != nil {
+		delete(r.cache, pid)
+		return Container{}, false
+	}
+	c, ok := parseCgroup(data)
+	r.cache[pid] = &entry{container: c, ok: ok, start: start, gen: r.gen}
+	return c, ok
+}
+
+// startTime reads the starttime field of <dir>/stat, the 22nd field. The
+// command name before it is parenthesized and may hold spaces.
+func startTime(dir string) (uint64, error) {
+	data, err := os.ReadFile(filepath.Join(dir, "stat"))
+	if err != nil {
+		return 0, err
+	}
+	end := bytes.LastIndexByte(data, ')')
+	if end < 0 {
+		return 0, fmt.Errorf("malformed %s/stat", dir)
+	}
+	// the fields after the command start at the 3rd, the state
+	fields := bytes.Fields(data[end+1:])
+	if len(fields) < 20 {
+		return 0, fmt.Errorf("malformed %s/stat", dir)
+	}
+	return strconv.ParseUint(string(fields[19]), 10, 64)
+}
+
+// Sweep forgets the PIDs not resolved since the previous sweep and returns
+// how many were dropped
+func (r *Resolver) Sweep() int {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	dropped := 0
+	for pid, e := range r.cache {
+		if e.gen != r.gen {
+			delete(r.cache, pid)
+			dropped++
+		}
+	}
+	r.gen++
+	return dropped
+}
+
+// Len returns the number of cached PIDs
+func (r *Resolver) Len() int {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	return len(r.cache)
+}
@@ -0,0 +1,318 @@
+package topology
+
+import (
+	"math/bits"
+	"sort"
+)
+
+// Device describes where a card sits in the node
+type Device struct {
+	ID         string
+	Numa       int      // NUMA node, negative when unknown
+	PcieSwitch string   // sysfs path of the upstream PCIe switch, empty when unknown
+	Esl        []string // IDs of the cards linked through ESL, one entry per port
+}
+
+// Topology is the interconnect graph of the cards of a node
+type Topology struct {
+	ids   []string
+	index map[string]int
+	// pair holds the pairwise score of two cards, see pairScore
+	pair [][]int64
+	// ranked holds every subset of a common request size, best first
+	ranked map[int]*ranking
+}
+
+// candidate is a set of cards, bit i standing for the card at index i
+type candidate struct {
+	set   uint64
+	score int64
+}
+
+// ranking orders the subsets of one size, pos indexes them by card mask so
+// a few free cards are answered by probing their own subsets instead of
+// scanning the ranking
+type ranking struct {
+	sets []candidate
+	pos  map[uint64]int32 // set -> index in sets
+}
+
+// rankedSizes are the request sizes answered from a precomputed ranking,
+// other sizes and rankings above maxRanked subsets fall back to the greedy
+// search
+var rankedSizes = []int{1, 2, 4, 8, 16}
+
+const maxRanked = 1 << 16
+
+// pair scores are ordered lexicographically: ESL links first, then a shared
+// NUMA node, then a shared PCIe switch
+const (
+	eslWeight    int64 = 1 << 32
+	numaWeight   int64 = 1 << 16
+	switchWeight int64 = 1
+)
+
+func New(devices []Device) *Topology {
+	t := &Topology{
+		ids:   make([]string, len(devices)),
+		index: make(map[string]int, len(devices)),
+		pair:  make([][]int64, len(devices)),
+	}
+	for i, device := range devices {
+		t.ids[i] = device.ID
+		t.index[device.ID] = i
+		t.pair[i] = make([]int64, len(devices))
+	}
+	for i, a := range devices {
+		for _, peer := range a.Esl {
+			if j, ok := t.index[peer]; ok && j != i {
+				t.pair[i][j] += eslWeight
+				t.pair[j][i] += eslWeight
+			}
+		}
+		for j := i + 1; j < len(devices); j++ {
+			b := devices[j]
+			var score int64
+			if a.Numa >= 0 && a.Numa == b.Numa {
+				score += numaWeight
+			}
+			if a.PcieSwitch != "" && a.PcieSwitch == b.PcieSwitch {
+				score += switchWeight
+			}
+			t.pair[i][j] += score
+			t.pair[j][i] += score
+		}
+	}
+	t.rank()
+	return t
+}
+
+// rank enumerates the subsets of every ranked size and orders them by
+// score, so Select only has to find the first one that is free
+func (t *Topology) rank() {
+	n := len(t.ids)
+	if n >= 64 {
+		return
+	}
+	t.ranked = make(map[int]*ranking, len(rankedSizes))
+	for _, size := range rankedSizes {
+		if size > n || binomial(n, size) > maxRanked {
+			continue
+		}
+		sets := make([]candidate, 0, binomial(n, size))
+		for set := uint64(1)<<size - 1; set < uint64(1)<<n; set = nextSubset(set) {
+			sets = append(sets, candidate{set: set, score: t.maskScore(set)})
+		}
+		sort.SliceStable(sets, func(i, j int) bool { return sets[i].score > sets[j].score })
+		pos := make(map[uint64]int32, len(sets))
+		for i, c := range sets {
+			pos[c.set] = int32(i)
+		}
+		t.ranked[size] = &ranking{sets: sets, pos: pos}
+	}
+}
+
+// nextSubset is Gosper's hack, it walks the words with the same number of
+// bits set in increasing order. set must not be zero.
+func nextSubset(set uint64) uint64 {
+	low := set & -set
+	high := set + low
+	return (set^high)>>(bits.TrailingZeros64(low)+2) | high
+}
+
+func (t *Topology) maskScore(set uint64) int64 {
+	var score int64
+	for rest := set; rest != 0; rest &= rest - 1 {
+		i := bits.TrailingZeros64(rest)
+		for others := rest & (rest - 1); others != 0; others &= others - 1 {
+			score += t.pair[i][bits.TrailingZeros64(others)]
+		}
+	}
+	return score
+}
+
+// binomial returns n choose k, saturating above maxRanked
+func binomial(n, k int) int {
+	if k > n-k {
+		k = n - k
+	}
+	c := 1
+	for i := 1; i <= k; i++ {
+		c = c * (n - k + i) / i
+		if c > maxRanked {
+			return maxRanked + 1
+		}
+	}
+	return c
+}
+
+// Len returns the number of cards
+func (t *Topology) Len() int {
+	return len(t.ids)
+}
+
+// Score rates how well the given cards are connected to each other, unknown
+// IDs are ignored
+func (t *Topology) Score(ids []string) int64 {
+	set := t.indexes(ids)
+	var score int64
+	for i := range set {
+		for j := i + 1; j < len(set); j++ {
+			score += t.pair[set[i]][set[j]]
+		}
+	}
+	return score
+}
+
+// Select picks size cards out of available, keeping every card of
+// mustInclude, so that the chosen set has the best interconnect. The result
+// is nil when available cannot satisfy the request.
+func (t *Topology) Select(available, mustInclude []string, size int) []string {
+	must := t.indexes(mustInclude)
+	free := t.indexes(available)
+	if size <= 0 || size > len(free) || len(must) > size {
+		return nil
+	}
+
+	if r, ok := t.ranked[size]; ok {
+		if set, ok := r.lookup(mask(free)|mask(must), mask(must), size); ok {
+			return t.names(members(set))
+		}
+	}
+
+	var best []int
+	bestScore := int64(-1)
+	if len(must) > 0 {
+		best, bestScore = t.grow(must, free, size)
+	} else {
+		// the greedy growth depends on the seed, try every card
+		for _, seed := range free {
+			set, score := t.grow([]int{seed}, free, size)
+			if score > bestScore {
+				best, bestScore = set, score
+			}
+		}
+	}
+	if best == nil {
+		return nil
+	}
+	return t.names(best)
+}
+
+// grow extends set with the free cards adding the most to its score until
+// it reaches size
+func (t *Topology) grow(set, free []int, size int) ([]int, int64) {
+	in := make([]bool, len(t.ids))
+	chosen := make([]int, 0, size)
+	var score int64
+	for _, i := range set {
+		if in[i] {
+			continue
+		}
+		for _, j := range chosen {
+			score += t.pair[i][j]
+		}
+		in[i] = true
+		chosen = append(chosen, i)
+	}
+	for len(chosen) < size {
+		next, gain := -1, int64(-1)
+		for _, i := range free {
+			if in[i] {
+				continue
+			}
+			var g int64
+			for _, j := range chosen {
+				g += t.pair[i][j]
+			}
+			if g > gain {
+				next, gain = i, g
+			}
+		}
+		if next < 0 {
+			return nil, -1
+		}
+		in[next] = true
+		chosen = append(chosen, next)
+		score += gain
+	}
+	return chosen, score
+}
+
+// lookup returns the best ranked set of size cards made of free cards only
+// and holding every card of must. Few free cards probe their subsets in
+// the index, many scan the ranking, which then stops early.
+func (r *ranking) lookup(free, must uint64, size int) (uint64, bool) {
+	extra := free &^ must
+	n, need := bits.OnesCount64(extra), size-bits.OnesCount64(must)
+	if need < 0 || need > n {
+		return 0, false
+	}
+	if need == 0 {
+		_, ok := r.pos[must]
+		return must, ok
+	}
+	// with c free subsets one of the first len/c ranked sets is expected to
+	// be free, probe the c subsets only when that is cheaper
+	if c := binomial(n, need); c*c > len(r.sets) {
+		for _, c := range r.sets {
+			if c.set&^free == 0 && c.set&must == must {
+				return c.set, true
+			}
+		}
+		return 0, false
+	}
+
+	var rest [64]uint8
+	for k := 0; extra != 0; extra &= extra - 1 {
+		rest[k] = uint8(bits.TrailingZeros64(extra))
+		k++
+	}
+	best, bestPos := uint64(0), int32(-1)
+	for pick := uint64(1)<<need - 1; pick < uint64(1)<<n; pick = nextSubset(pick) {
+		set := must
+		for p := pick; p != 0; p &= p - 1 {
+			set |= 1 << rest[bits.TrailingZeros64(p)]
+		}
+		if pos, ok := r.pos[set]; ok && (bestPos < 0 || pos < bestPos) {
+			best, bestPos = set, pos
+		}
+	}
+	return best, bestPos >= 0
+}
+
+func mask(set []int) uint64 {
+	var m uint64
+	for _, i := range set {
+		m |= 1 << i
+	}
+	return m
+}
+
+func members(set uint64) []int {
+	indexes := make([]int, 0, bits.OnesCount64(set))
+	for ; set != 0; set &= set - 1 {
+		indexes = append(indexes, bits.TrailingZeros64(set))
+	}
+	return indexes
+}
+
+func (t *Topology) indexes(ids []string) []int {
+	set := make([]int, 0, len(ids))
+	for _, id := range ids {
+		if i, ok := t.index[id]; ok {
+			set = append(set, i)
+		}
+	}
+	sort.Ints(set)
+	return set
+}
+
+func (t *Topology) names(set []int) []string {
+	sort.Ints(set)
+	ids := make([]string, len(set))
+	for k, i := range set {
+		ids[k] = t.ids[i]
+	}
+	return ids
+}
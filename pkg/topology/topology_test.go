@@ -0,0 +1,89 @@
+package topology
+
+import (
+	"fmt"
+	"math/rand"
+	"strconv"
+	"testing"
+)
+
+// synthetic lays n cards out as a typical OAM node: two NUMA nodes, a PCIe
+// switch per four cards and an ESL ring per eight cards
+func synthetic(n int) *Topology {
+	devices := make([]Device, n)
+	for i := range devices {
+		group := i / 8 * 8
+		devices[i] = Device{
+			ID:         strconv.Itoa(i),
+			Numa:       i * 2 / n,
+			PcieSwitch: fmt.Sprintf("switch%d", i/4),
+			Esl: []string{
+				strconv.Itoa(group + (i+1)%8),
+				strconv.Itoa(group + (i+7)%8),
+			},
+		}
+	}
+	return New(devices)
+}
+
+// available returns every card but a random share of busy ones
+func available(n int, busy float64, rnd *rand.Rand) []string {
+	ids := make([]string, 0, n)
+	for i := 0; i < n; i++ {
+		if rnd.Float64() >= busy {
+			ids = append(ids, strconv.Itoa(i))
+		}
+	}
+	return ids
+}
+
+// TestLookupProbes checks the index probing picks the set the full scan of
+// the ranking does
+func TestLookupProbes(t *testing.T) {
+	rnd := rand.New(rand.NewSource(1))
+	for _, n := range []int{8, 16, 32} {
+		topo := synthetic(n)
+		for size, r := range topo.ranked {
+			for k := 0; k < 200; k++ {
+				free := mask(topo.indexes(available(n, rnd.Float64(), rnd)))
+				var must uint64
+				if k%2 == 1 && free != 0 {
+					must = free & -free
+				}
+				want, wantOK := uint64(0), false
+				for _, c := range r.sets {
+					if c.set&^free == 0 && c.set&must == must {
+						want, wantOK = c.set, true
+						break
+					}
+				}
+				got, ok := r.lookup(free, must, size)
+				if ok != wantOK || got != want {
+					t.Fatalf("%d cards, size %d, free %b, must %b: got %b %v, want %b %v",
+						n, size, free, must, got, ok, want, wantOK)
+				}
+			}
+		}
+	}
+}
+
+func BenchmarkSelect(b *testing.B) {
+	for _, n := range []int{8, 16, 32} {
+		topo := synthetic(n)
+		for _, size := range []int{1, 2, 4, 8} {
+			for _, busy := range []float64{0, 0.5, 0.8} {
+				rnd := rand.New(rand.NewSource(int64(n)))
+				frees := make([][]string, 64)
+				for i := range frees {
+					frees[i] = available(n, busy, rnd)
+				}
+				b.Run(fmt.Sprintf("cards=%d/size=%d/busy=%.0f%%", n, size, busy*100), func(b *testing.B) {
+					b.ReportAllocs()
+					for i := 0; i < b.N; i++ {
+						topo.Select(frees[i%len(frees)], nil, size)
+					}
+				})
+			}
+		}
+	}
+}
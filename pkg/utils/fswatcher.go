@@ -4,12 +4,10 @@ import (
 	"github.com/fsnotify/fsnotify"
 	"github.com/pkg/errors"
 	"k8s.io/klog/v2"
-
-	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
 )
 
 // WatchKubelet restart device plugin when kubelet restarted
-func WatchKubelet(stop chan<- struct{}) error {
+func WatchKubelet(socket string, stop chan<- struct{}) error {
 	watcher, err := fsnotify.NewWatcher()
 	if err != nil {
 		return errors.WithMessage(err, "Unable to create fsnotify watcher")
@@ -25,7 +23,7 @@ func WatchKubelet(stop chan<- struct{}) error {
 					continue
 				}
 				klog.Infof("fsnotify events: %s %v", event.Name, event.Op.String())
-				if event.Name == pluginapi.KubeletSocket && event.Op == fsnotify.Create {
+				if event.Name == socket && event.Op == fsnotify.Create {
 					klog.Warning("inotify: kubelet.sock created, restarting.")
 					stop <- struct{}{}
 				}
@@ -39,9 +37,9 @@ func WatchKubelet(stop chan<- struct{}) error {
 	}()
 
 	// watch kubelet.sock
-	err = watcher.Add(pluginapi.KubeletSocket)
+	err = watcher.Add(socket)
 	if err != nil {
-		return errors.WithMessagef(err, "Unable to add path %s to watcher", pluginapi.KubeletSocket)
+		return errors.WithMessagef(err, "Unable to add path %s to watcher", socket)
 	}
 	return nil
 }